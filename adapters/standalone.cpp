@@ -23,6 +23,8 @@
 #include <string.hpp>
 #include <library.hpp>
 #include <network.hpp>
+#include <bench.hpp>
+#include <trace.hpp>
 
 #include <getopt.h>
 #include <unistd.h> // for getopt
@@ -71,6 +73,14 @@ int main(int argc, char* argv[]) {
 	std::string patchPath;
 	bool screenshot = false;
 	float screenshotZoom = 1.f;
+	bool randomSeedSet = false;
+	uint64_t randomSeed = 0;
+	bool runBench = false;
+	std::string benchFilter;
+	bool runEngineBench = false;
+	std::string engineBenchArgs;
+	bool runTrace = false;
+	std::string tracePath;
 	const std::string appInfo = APP_NAME + " " + APP_EDITION_NAME + " " + APP_VERSION + " " + APP_OS_NAME + " " + APP_CPU_NAME;
 
 	// Parse command line arguments
@@ -83,6 +93,10 @@ int main(int argc, char* argv[]) {
 		{"user", required_argument, NULL, 'u'},
 		{"version", no_argument, NULL, 'v'},
 		{"help", no_argument, NULL, 256},
+		{"seed", required_argument, NULL, 257},
+		{"bench", optional_argument, NULL, 258},
+		{"bench-engine", optional_argument, NULL, 259},
+		{"trace", optional_argument, NULL, 260},
 		{NULL, 0, NULL, 0}
 	};
 	int c;
@@ -118,6 +132,25 @@ int main(int argc, char* argv[]) {
 				std::fprintf(stderr, "https://vcvrack.com/manual/Installing#Command-line-usage\n");
 				return 0;
 			}
+			case 257: { // --seed
+				randomSeedSet = true;
+				randomSeed = std::strtoull(optarg, NULL, 10);
+			} break;
+			case 258: { // --bench
+				runBench = true;
+				if (optarg)
+					benchFilter = optarg;
+			} break;
+			case 259: { // --bench-engine
+				runEngineBench = true;
+				if (optarg)
+					engineBenchArgs = optarg;
+			} break;
+			case 260: { // --trace
+				runTrace = true;
+				if (optarg)
+					tracePath = optarg;
+			} break;
 			// Mac "app translocation" passes a nonsense -psn_... flag, so -p is reserved.
 			case 'p': break;
 			default: break;
@@ -134,8 +167,38 @@ int main(int argc, char* argv[]) {
 		logger::logPath = asset::user("log.txt");
 	}
 	logger::init();
+	if (randomSeedSet) {
+		// Makes noise reproducible between runs, e.g. for offline renders
+		INFO("Using random seed %llu", (unsigned long long) randomSeed);
+		random::seed(randomSeed);
+	}
 	random::init();
 
+	if (runBench || runEngineBench) {
+		// Runs before settings are loaded so results don't depend on the user's settings
+		int status = 0;
+		try {
+			if (runBench)
+				bench::run(benchFilter);
+			if (runEngineBench)
+				bench::runEngine(engineBenchArgs);
+		}
+		catch (std::exception& e) {
+			WARN("Benchmark failed: %s", e.what());
+			status = 1;
+		}
+		logger::destroy();
+		return status;
+	}
+
+	if (runTrace) {
+		// Start before anything else is initialized, so plugin loading and the first patch load are recorded
+		if (tracePath.empty())
+			tracePath = asset::user("trace.json");
+		INFO("Recording performance trace to %s", tracePath.c_str());
+		trace::start();
+	}
+
 	// Test code
 	// exit(0);
 
@@ -282,6 +345,17 @@ int main(int argc, char* argv[]) {
 		settings::save();
 	}
 
+	// Save trace unless it was already saved from the menu bar
+	if (runTrace && trace::isEnabled()) {
+		try {
+			trace::save(tracePath);
+			INFO("Saved trace to %s", tracePath.c_str());
+		}
+		catch (Exception& e) {
+			WARN("%s", e.what());
+		}
+	}
+
 	// Destroy environment
 	if (!settings::headless) {
 		INFO("Destroying window");
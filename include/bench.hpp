@@ -0,0 +1,109 @@
+#pragma once
+#include <functional>
+
+#include <common.hpp>
+
+
+namespace rack {
+
+
+namespace engine {
+struct Engine;
+} // namespace engine
+
+
+/** Micro-benchmarks of DSP primitives, SIMD math, and engine hot paths, for comparing performance between builds.
+
+Run with `./Rack --bench` or `make bench`.
+Pass a filter such as `--bench=dsp.` to run only benchmarks whose names contain it.
+*/
+namespace bench {
+
+
+/** Prevents the compiler from optimizing away the computation of `x`. */
+template <typename T>
+inline void use(const T& x) {
+	__asm__ __volatile__("" : : "r"(&x) : "memory");
+}
+
+
+/** Performs `iterations` iterations of the measured operation. */
+typedef std::function<void(int64_t iterations)> Function;
+
+
+struct Result {
+	std::string name;
+	/** Iterations per repetition */
+	int64_t iterations = 0;
+	int repetitions = 0;
+	/** Nanoseconds per iteration */
+	double nsMedian = 0.0;
+	double nsMin = 0.0;
+};
+
+
+/** Calibrates the number of iterations so each repetition takes about `repetitionTime` seconds, then times `repetitions` repetitions. */
+PRIVATE Result measure(const std::string& name, Function f, double repetitionTime = 0.05, int repetitions = 5);
+
+/** Runs all benchmarks whose names contain `filter`.
+Writes one JSON object per line to stdout, for example
+
+	{"name": "dsp.BiquadFilter", "iterations": 1048576, "repetitions": 5, "nsMedian": 4.21, "nsMin": 4.18}
+
+so results of two builds can be compared with a script.
+*/
+PRIVATE void run(const std::string& filter);
+
+
+/** Describes a synthetic patch of modules that don't depend on plugins. */
+struct PatchOptions {
+	enum Topology {
+		/** Each module's outputs are patched to the next module's inputs. */
+		CHAIN,
+		/** Modules mix down into a single root module, where each module has `ports` children. */
+		TREE,
+		/** Each input is patched from a random earlier module, or from a later module with probability `feedback`. */
+		DAG,
+		NUM_TOPOLOGIES
+	};
+	Topology topology = CHAIN;
+	int modules = 64;
+	/** Number of inputs and outputs of each module */
+	int ports = 2;
+	/** Polyphony of each output, from 1 to 16 */
+	int channels = 4;
+	/** Work per channel group per frame, in nonlinear one-pole filter stages. 0 copies the inputs to the outputs. */
+	int cost = 8;
+	/** Cost of each module is randomly chosen within `cost * (1 +- costVariation)`. */
+	float costVariation = 0.5f;
+	float feedback = 0.1f;
+	/** Seed for the topology and costs, so patches are identical between runs */
+	uint64_t seed = 1;
+};
+
+PRIVATE std::string getTopologyName(PatchOptions::Topology topology);
+/** Adds modules and cables to an empty Engine. */
+PRIVATE void buildPatch(engine::Engine* engine, const PatchOptions& options);
+
+/** Measures Engine throughput for synthetic patches, sweeping thread counts and block sizes.
+Needs no audio device, window, or plugins.
+
+`args` is a comma-separated list of options, such as `topology=dag,modules=256,threads=1:2:4`.
+
+- `topology`: `chain`, `tree`, `dag`, or `all` (default)
+- `modules`, `ports`, `channels`, `cost`, `costVariation`, `feedback`, `seed`: see PatchOptions
+- `threads`: colon-separated thread counts. Defaults to powers of 2 up to the number of logical cores.
+- `blocks`: colon-separated block sizes in frames. Defaults to `64:256:1024`.
+- `duration`: seconds to measure each configuration. Defaults to 1.
+
+Writes one JSON object per configuration to stdout with
+- `framesPerSecond`: throughput
+- `realtime`: throughput divided by the engine sample rate, i.e. how many copies of the patch could run in real time
+- `frameNsP50`, `frameNsP90`, `frameNsP99`, `frameNsMax`: percentiles of the duration of each stepBlock() call divided by its frames
+- `efficiency`: speedup over the first thread count divided by the increase in threads, where 1 is perfect scaling
+*/
+PRIVATE void runEngine(const std::string& args);
+
+
+} // namespace bench
+} // namespace rack
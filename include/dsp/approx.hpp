@@ -102,6 +102,18 @@ inline simd::float_4 exp2Floor(simd::float_4 x, simd::float_4* xf) {
 	return simd::float_4::cast(yii);
 }
 
+#ifdef SIMD_TARGET_AVX2
+template <>
+SIMD_TARGET_AVX2 inline simd::float_8 exp2Floor(simd::float_8 x, simd::float_8* xf) {
+	x += 127;
+	simd::int32_8 xi = x;
+	if (xf)
+		*xf = x - simd::float_8(xi);
+	simd::int32_8 yii = xi << 23;
+	return simd::float_8::cast(yii);
+}
+#endif
+
 /** Deprecated alias of exp2Floor() */
 template <typename T>
 T approxExp2Floor(T x, T* xf) {
@@ -138,5 +150,139 @@ T approxExp2_taylor5(T x) {
 }
 
 
+/** Returns `floor(log2(x))` for positive normal `x`.
+If xf is given, sets it to the mantissa `x / 2^floor(log2(x))` in the range [1, 2).
+This is useful in the computation `log2(x) = floor(log2(x)) + log2(mantissa)`.
+*/
+template <typename T>
+T log2Floor(T x, T* xf);
+
+template <>
+inline float log2Floor(float x, float* xf) {
+	union {
+		float xi;
+		int32_t xii;
+	};
+	xi = x;
+	int32_t e = ((xii >> 23) & 0xff) - 127;
+	if (xf) {
+		// Replace exponent with 0
+		xii = (xii & 0x007fffff) | 0x3f800000;
+		*xf = xi;
+	}
+	return e;
+}
+
+template <>
+inline simd::float_4 log2Floor(simd::float_4 x, simd::float_4* xf) {
+	simd::int32_4 xii = simd::int32_4::cast(x);
+	simd::int32_4 e = ((xii >> 23) & 0xff) - 127;
+	if (xf)
+		*xf = simd::float_4::cast((xii & 0x007fffff) | 0x3f800000);
+	return e;
+}
+
+#ifdef SIMD_TARGET_AVX2
+template <>
+SIMD_TARGET_AVX2 inline simd::float_8 log2Floor(simd::float_8 x, simd::float_8* xf) {
+	simd::int32_8 xii = simd::int32_8::cast(x);
+	simd::int32_8 e = ((xii >> 23) & 0xff) - 127;
+	if (xf)
+		*xf = simd::float_8::cast((xii & 0x007fffff) | 0x3f800000);
+	return e;
+}
+#endif
+
+
+/** Returns log2(x) with at most 2e-05 absolute error for positive normal `x`, or 1.6e-05 when 1/32 <= x < 32.
+The error grows with |log2(x)| because the result is rounded to a float, whose resolution decreases as its integer part grows.
+
+Returns exact values at powers of 2 and is continuous between octaves.
+About 2.5x faster than `simd::log2()`, which has at most 1.3e-06 absolute error.
+*/
+template <typename T>
+T log2_taylor5(T x) {
+	T xf;
+	T yi = log2Floor(x, &xf);
+
+	// Minimax polynomial for log2(1 + t) on [0, 1), constrained to p(0) = 0 and p(1) = 1
+	const T a[] = {
+		0.0,
+		1.44191703681,
+		-0.709096422457,
+		0.415605988648,
+		-0.19357561777,
+		0.0451490147673,
+	};
+	T yf = polyHorner(a, xf - 1);
+	return yi + yf;
+}
+
+
+/** Returns `a^b` for positive normal `a`, with at most 7e-05 relative error when `|b * log2(a)| <= 10`.
+
+To raise a fixed base to a varying power, precompute `c = std::log2(base)` and call `exp2_taylor5(c * x)` instead.
+For integer exponents known at compile time, `simd::pow(x, int)` is exact and faster.
+*/
+template <typename T>
+T pow_taylor5(T a, T b) {
+	return exp2_taylor5(b * log2_taylor5(a));
+}
+
+
+/** Returns tanh(x) with at most 1.4e-06 absolute error.
+*/
+template <typename T>
+T tanh_taylor5(T x) {
+	// tanh(|x|) = (1 - e^(-2|x|)) / (1 + e^(-2|x|))
+	// Limit the domain so exp2Floor() doesn't underflow. tanh(9) is 1 in single precision.
+	T ax = simd::fmin(simd::fabs(x), T(9.f));
+	T e = exp2_taylor5(ax * T(-2 * M_LOG2E));
+	T y = (1 - e) / (1 + e);
+	return simd::sgn(x) * y;
+}
+
+
+/** Returns the [3/2] Padé approximant of tanh(x), clamped to [-1, 1].
+Has at most 0.024 absolute error, but is smooth and monotonic, so it's useful as a saturator.
+*/
+template <typename T>
+T tanh_pade(T x) {
+	T x2 = x * x;
+	T y = x * (27 + x2) / (27 + 9 * x2);
+	return simd::clamp(y, T(-1.f), T(1.f));
+}
+
+
+/** Returns tan(x) for `|x| < π/2`.
+Has at most 8e-07 relative error for `|x| <= 1.5`.
+Closer to the poles, the error grows because of the rounding of π/2 in single precision, up to 5e-04 at `|x| = 1.5707`.
+
+Uses a [5/4] Padé approximant on [-π/4, π/4] and the identity `tan(x) = 1 / tan(π/2 - x)` outside it.
+About 5x faster than `std::tan()`.
+*/
+template <typename T>
+T tan_pade(T x) {
+	T ax = simd::fabs(x);
+	auto big = (ax > T(M_PI / 4));
+	T r = simd::ifelse(big, T(M_PI / 2) - ax, ax);
+	T r2 = r * r;
+	T p = r * (945 + r2 * (-105 + r2));
+	T q = 945 + r2 * (-420 + r2 * 15);
+	T y = simd::ifelse(big, q, p) / simd::ifelse(big, p, q);
+	return simd::sgn(x) * y;
+}
+
+
+/** Cubic soft clipper.
+Linear with slope 1.5 near 0 and saturates smoothly to ±1 at `|x| >= 1`.
+*/
+template <typename T>
+T softclip(T x) {
+	x = simd::clamp(x, T(-1.f), T(1.f));
+	return x * (T(1.5f) - T(0.5f) * x * x);
+}
+
+
 } // namespace dsp
 } // namespace rack
@@ -8,10 +8,94 @@ namespace rack {
 namespace dsp {
 
 
+/** Returns whether PFFFT supports transforms of the given length.
+Lengths must be of the form `2^a * 3^b * 5^c`, and a multiple of 32 for real transforms or 16 for complex transforms.
+*/
+bool isFftLengthValid(int length, pffft_transform_t type);
+
+/** Returns the smallest supported length greater than or equal to `length`.
+Useful for zero-padding signals of arbitrary length.
+*/
+int getFftLength(int length, pffft_transform_t type);
+
+/** Returns the PFFFT setup for the given length and type, creating it on first use.
+Setups are immutable, so they are shared by all FftContexts in the process and kept until exit.
+Don't pass the result to pffft_destroy_setup().
+Throws Exception if the length is not supported.
+*/
+PFFFT_Setup* getFftSetup(int length, pffft_transform_t type);
+
+
+/** Array aligned for SIMD, as required by PFFFT.
+Movable but not copyable.
+*/
+template <typename T = float>
+struct AlignedBuffer {
+	T* data = NULL;
+	size_t size = 0;
+
+	AlignedBuffer() {}
+	AlignedBuffer(size_t size) {
+		resize(size);
+	}
+	AlignedBuffer(const AlignedBuffer&) = delete;
+	AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+	AlignedBuffer(AlignedBuffer&& other) {
+		data = other.data;
+		size = other.size;
+		other.data = NULL;
+		other.size = 0;
+	}
+	AlignedBuffer& operator=(AlignedBuffer&& other) {
+		if (this != &other) {
+			if (data)
+				pffft_aligned_free(data);
+			data = other.data;
+			size = other.size;
+			other.data = NULL;
+			other.size = 0;
+		}
+		return *this;
+	}
+
+	~AlignedBuffer() {
+		if (data)
+			pffft_aligned_free(data);
+	}
+
+	/** Reallocates the buffer and sets all elements to 0.
+	Previous contents are not preserved.
+	Throws Exception if the allocation fails, leaving the buffer empty.
+	*/
+	void resize(size_t size) {
+		if (data) {
+			pffft_aligned_free(data);
+			data = NULL;
+		}
+		this->size = 0;
+		if (size > 0) {
+			data = (T*) pffft_aligned_malloc(sizeof(T) * size);
+			if (!data)
+				throw Exception("Could not allocate aligned buffer of %llu bytes", (unsigned long long) (sizeof(T) * size));
+			std::memset(data, 0, sizeof(T) * size);
+			this->size = size;
+		}
+	}
+
+	T& operator[](size_t i) {
+		return data[i];
+	}
+	const T& operator[](size_t i) const {
+		return data[i];
+	}
+};
+
+
 /** Real-valued FFT context.
 Wrapper for [PFFFT](https://bitbucket.org/jpommier/pffft/)
 `length` must be a multiple of 32.
 Buffers must be aligned to 16-byte boundaries. new[] and malloc() do this for you.
+To share setups between contexts or transform many frames at once, use FftContext.
 */
 struct RealFFT {
 	PFFFT_Setup* setup;
@@ -125,5 +209,75 @@ struct ComplexFFT {
 };
 
 
+/** FFT context that shares its PFFFT setup with all other contexts of the same length and type.
+Unlike RealFFT and ComplexFFT, it is cheap to create, and it keeps a scratch buffer so large transforms don't allocate on the stack.
+Each context has its own scratch buffer, so a context must not be used by multiple threads at once.
+
+Frames are `length` elements for PFFFT_REAL and `2*length` elements for PFFFT_COMPLEX, in both input and output.
+Throws Exception if the length is not supported. See getFftLength().
+*/
+struct FftContext {
+	PFFFT_Setup* setup;
+	pffft_transform_t type;
+	int length;
+	/** Scratch space for PFFFT */
+	AlignedBuffer<float> work;
+
+	FftContext(int length, pffft_transform_t type = PFFFT_REAL) {
+		this->length = length;
+		this->type = type;
+		setup = getFftSetup(length, type);
+		work.resize(getFrameSize());
+	}
+
+	/** Returns the number of elements in each input and output frame. */
+	int getFrameSize() const {
+		return (type == PFFFT_REAL) ? length : 2 * length;
+	}
+
+	/** Transforms `count` consecutive frames, e.g. the frames of an STFT or the channels of a polyphonic signal.
+	Output is ordered like RealFFT::rfftUnordered() or ComplexFFT::fftUnordered().
+	*/
+	void forwardUnordered(const float* input, float* output, int count = 1) {
+		int frameSize = getFrameSize();
+		for (int i = 0; i < count; i++) {
+			pffft_transform(setup, &input[i * frameSize], &output[i * frameSize], work.data, PFFFT_FORWARD);
+		}
+	}
+
+	/** Scaling is such that backwardUnordered(forwardUnordered(x)) = N*x. */
+	void backwardUnordered(const float* input, float* output, int count = 1) {
+		int frameSize = getFrameSize();
+		for (int i = 0; i < count; i++) {
+			pffft_transform(setup, &input[i * frameSize], &output[i * frameSize], work.data, PFFFT_BACKWARD);
+		}
+	}
+
+	/** Slower than forwardUnordered(), but output is in the canonical order of RealFFT::rfft() or ComplexFFT::fft(). */
+	void forward(const float* input, float* output, int count = 1) {
+		int frameSize = getFrameSize();
+		for (int i = 0; i < count; i++) {
+			pffft_transform_ordered(setup, &input[i * frameSize], &output[i * frameSize], work.data, PFFFT_FORWARD);
+		}
+	}
+
+	void backward(const float* input, float* output, int count = 1) {
+		int frameSize = getFrameSize();
+		for (int i = 0; i < count; i++) {
+			pffft_transform_ordered(setup, &input[i * frameSize], &output[i * frameSize], work.data, PFFFT_BACKWARD);
+		}
+	}
+
+	/** Scales `count` frames so that `scale(backward(forward(x))) = x`. */
+	void scale(float* x, int count = 1) {
+		float a = 1.f / length;
+		int n = count * getFrameSize();
+		for (int i = 0; i < n; i++) {
+			x[i] *= a;
+		}
+	}
+};
+
+
 } // namespace dsp
 } // namespace rack
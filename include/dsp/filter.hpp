@@ -1,5 +1,6 @@
 #pragma once
 #include <dsp/common.hpp>
+#include <dsp/approx.hpp>
 
 
 namespace rack {
@@ -431,10 +432,229 @@ struct TBiquadFilter : IIRFilter<3, 3, T> {
 			default: break;
 		}
 	}
+
+	/** Calculates biquad transfer function coefficients without setting them.
+	Unlike setParameters(), the arguments can be SIMD types, so each element can have its own frequency, Q, and gain.
+	Uses tan_pade() instead of `std::tan()`, so it's cheap enough to call every few samples.
+	f: normalized frequency (cutoff frequency / sample rate), must be less than 0.5
+	Q: quality factor
+	V: gain
+	b: output numerator coefficients b_0, b_1, b_2
+	a: output denominator coefficients a_1, a_2
+	*/
+	static void computeCoefficients(Type type, T f, T Q, T V, T* b, T* a) {
+		const T sqrt2 = M_SQRT2;
+		T K = tan_pade(T(M_PI) * f);
+		T K2 = K * K;
+		switch (type) {
+			case LOWPASS_1POLE: {
+				a[0] = -simd::exp(T(-2.f * M_PI) * f);
+				a[1] = 0.f;
+				b[0] = 1.f + a[0];
+				b[1] = 0.f;
+				b[2] = 0.f;
+			} break;
+
+			case HIGHPASS_1POLE: {
+				a[0] = simd::exp(T(-2.f * M_PI) * (0.5f - f));
+				a[1] = 0.f;
+				b[0] = 1.f - a[0];
+				b[1] = 0.f;
+				b[2] = 0.f;
+			} break;
+
+			case LOWPASS: {
+				T norm = 1.f / (1.f + K / Q + K2);
+				b[0] = K2 * norm;
+				b[1] = 2.f * b[0];
+				b[2] = b[0];
+				a[0] = 2.f * (K2 - 1.f) * norm;
+				a[1] = (1.f - K / Q + K2) * norm;
+			} break;
+
+			case HIGHPASS: {
+				T norm = 1.f / (1.f + K / Q + K2);
+				b[0] = norm;
+				b[1] = -2.f * b[0];
+				b[2] = b[0];
+				a[0] = 2.f * (K2 - 1.f) * norm;
+				a[1] = (1.f - K / Q + K2) * norm;
+			} break;
+
+			// For shelf and peak filters, compute both the boost and cut formulas and select per element.
+			case LOWSHELF: {
+				T sqrtV = simd::sqrt(V);
+				auto boost = (V >= 1.f);
+				T norm1 = 1.f / (1.f + sqrt2 * K + K2);
+				T norm2 = 1.f / (1.f + sqrt2 / sqrtV * K + K2 / V);
+				b[0] = simd::ifelse(boost, (1.f + sqrt2 * sqrtV * K + V * K2) * norm1, (1.f + sqrt2 * K + K2) * norm2);
+				b[1] = simd::ifelse(boost, 2.f * (V * K2 - 1.f) * norm1, 2.f * (K2 - 1.f) * norm2);
+				b[2] = simd::ifelse(boost, (1.f - sqrt2 * sqrtV * K + V * K2) * norm1, (1.f - sqrt2 * K + K2) * norm2);
+				a[0] = simd::ifelse(boost, 2.f * (K2 - 1.f) * norm1, 2.f * (K2 / V - 1.f) * norm2);
+				a[1] = simd::ifelse(boost, (1.f - sqrt2 * K + K2) * norm1, (1.f - sqrt2 / sqrtV * K + K2 / V) * norm2);
+			} break;
+
+			case HIGHSHELF: {
+				T sqrtV = simd::sqrt(V);
+				auto boost = (V >= 1.f);
+				T norm1 = 1.f / (1.f + sqrt2 * K + K2);
+				T norm2 = 1.f / (1.f / V + sqrt2 / sqrtV * K + K2);
+				b[0] = simd::ifelse(boost, (V + sqrt2 * sqrtV * K + K2) * norm1, (1.f + sqrt2 * K + K2) * norm2);
+				b[1] = simd::ifelse(boost, 2.f * (K2 - V) * norm1, 2.f * (K2 - 1.f) * norm2);
+				b[2] = simd::ifelse(boost, (V - sqrt2 * sqrtV * K + K2) * norm1, (1.f - sqrt2 * K + K2) * norm2);
+				a[0] = simd::ifelse(boost, 2.f * (K2 - 1.f) * norm1, 2.f * (K2 - 1.f / V) * norm2);
+				a[1] = simd::ifelse(boost, (1.f - sqrt2 * K + K2) * norm1, (1.f / V - sqrt2 / sqrtV * K + K2) * norm2);
+			} break;
+
+			case BANDPASS: {
+				T norm = 1.f / (1.f + K / Q + K2);
+				b[0] = K / Q * norm;
+				b[1] = 0.f;
+				b[2] = -b[0];
+				a[0] = 2.f * (K2 - 1.f) * norm;
+				a[1] = (1.f - K / Q + K2) * norm;
+			} break;
+
+			case PEAK: {
+				auto boost = (V >= 1.f);
+				T norm = 1.f / (1.f + K / Q * simd::ifelse(boost, T(1.f), 1.f / V) + K2);
+				b[0] = (1.f + K / Q * simd::ifelse(boost, V, T(1.f)) + K2) * norm;
+				b[1] = 2.f * (K2 - 1.f) * norm;
+				b[2] = (1.f - K / Q * simd::ifelse(boost, V, T(1.f)) + K2) * norm;
+				a[0] = b[1];
+				a[1] = (1.f - K / Q * simd::ifelse(boost, T(1.f), 1.f / V) + K2) * norm;
+			} break;
+
+			case NOTCH: {
+				T norm = 1.f / (1.f + K / Q + K2);
+				b[0] = (1.f + K2) * norm;
+				b[1] = 2.f * (K2 - 1.f) * norm;
+				b[2] = b[0];
+				a[0] = b[1];
+				a[1] = (1.f - K / Q + K2) * norm;
+			} break;
+
+			default: break;
+		}
+	}
 };
 
 typedef TBiquadFilter<> BiquadFilter;
 
 
+/** Series of biquad filters in transposed direct form II.
+Uses less state and fewer operations per sample than chaining IIRFilter instances, and is more accurate with single-precision coefficients.
+Use `T = float_4` to process 4 voices in parallel, each with its own coefficients.
+
+Coefficients can be ramped linearly over a number of frames, so modulated filters only need new coefficients once per block.
+
+Example:
+
+	dsp::TBiquadCascade<4, float_4> filter;
+
+	// Once per 32-sample block
+	for (int i = 0; i < 4; i++) {
+		filter.setParameters(i, dsp::TBiquadFilter<float_4>::LOWPASS, cutoff / sampleRate, q, 1.f, 32);
+	}
+	// Every sample
+	out = filter.process(in);
+*/
+template <int STAGES, typename T = float>
+struct TBiquadCascade {
+	/** Current numerator coefficients b_0, b_1, b_2 of each stage */
+	T b[STAGES][3] = {};
+	/** Current denominator coefficients a_1, a_2 of each stage */
+	T a[STAGES][2] = {};
+	/** Per-frame coefficient increments while ramping */
+	T bDelta[STAGES][3] = {};
+	T aDelta[STAGES][2] = {};
+	/** Target coefficients, set exactly when ramping finishes to avoid accumulated rounding */
+	T bTarget[STAGES][3];
+	T aTarget[STAGES][2];
+	/** Frames remaining in each stage's ramp */
+	int rampFrames[STAGES];
+	/** Transposed direct form II state */
+	T s[STAGES][2];
+
+	TBiquadCascade() {
+		for (int i = 0; i < STAGES; i++) {
+			// Pass-through
+			const T bPass[3] = {1.f, 0.f, 0.f};
+			const T aPass[2] = {0.f, 0.f};
+			setCoefficients(i, bPass, aPass);
+		}
+		reset();
+	}
+
+	void reset() {
+		for (int i = 0; i < STAGES; i++) {
+			s[i][0] = 0.f;
+			s[i][1] = 0.f;
+		}
+	}
+
+	/** Sets the coefficients of a stage.
+	If `frames` is positive, the coefficients reach their new values linearly over that many calls to process().
+	Ramping between two stable filters is not guaranteed to stay stable, but in practice it does for ramps of a block or so between nearby settings.
+	*/
+	void setCoefficients(int stage, const T* b, const T* a, int frames = 0) {
+		for (int j = 0; j < 3; j++)
+			bTarget[stage][j] = b[j];
+		for (int j = 0; j < 2; j++)
+			aTarget[stage][j] = a[j];
+
+		if (frames > 0) {
+			T r = 1.f / frames;
+			for (int j = 0; j < 3; j++)
+				bDelta[stage][j] = (b[j] - this->b[stage][j]) * r;
+			for (int j = 0; j < 2; j++)
+				aDelta[stage][j] = (a[j] - this->a[stage][j]) * r;
+			rampFrames[stage] = frames;
+		}
+		else {
+			finishRamp(stage);
+		}
+	}
+
+	/** Computes coefficients with TBiquadFilter::computeCoefficients() and sets them. */
+	void setParameters(int stage, typename TBiquadFilter<T>::Type type, T f, T Q, T V, int frames = 0) {
+		T b[3];
+		T a[2];
+		TBiquadFilter<T>::computeCoefficients(type, f, Q, V, b, a);
+		setCoefficients(stage, b, a, frames);
+	}
+
+	void finishRamp(int stage) {
+		for (int j = 0; j < 3; j++)
+			b[stage][j] = bTarget[stage][j];
+		for (int j = 0; j < 2; j++)
+			a[stage][j] = aTarget[stage][j];
+		rampFrames[stage] = 0;
+	}
+
+	T process(T in) {
+		for (int i = 0; i < STAGES; i++) {
+			if (rampFrames[i] > 0) {
+				if (--rampFrames[i] == 0) {
+					finishRamp(i);
+				}
+				else {
+					for (int j = 0; j < 3; j++)
+						b[i][j] += bDelta[i][j];
+					for (int j = 0; j < 2; j++)
+						a[i][j] += aDelta[i][j];
+				}
+			}
+
+			T out = b[i][0] * in + s[i][0];
+			s[i][0] = b[i][1] * in - a[i][0] * out + s[i][1];
+			s[i][1] = b[i][2] * in - a[i][1] * out;
+			in = out;
+		}
+		return in;
+	}
+};
+
+
 } // namespace dsp
 } // namespace rack
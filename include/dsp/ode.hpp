@@ -16,13 +16,17 @@ For example, the following solves the system x''(t) = -x(t) using a fixed timest
 	float x[2] = {1.f, 0.f};
 	float dt = 0.01f;
 	for (float t = 0.f; t < 1.f; t += dt) {
-		rack::ode::stepRK4(t, dt, x, 2, [&](float t, const float x[], float dxdt[]) {
+		rack::dsp::stepRK4(t, dt, x, [&](float t, const float x[], float dxdt[]) {
 			dxdt[0] = x[1];
 			dxdt[1] = -x[0];
 		});
 		printf("%f\n", x[0]);
 	}
 
+`T` can be a SIMD type such as `float_4` to solve the same system for 4 voices at once.
+
+Overloads taking an array reference `T (&x)[N]` size their temporary arrays at compile time, so the compiler can keep them in registers and unroll the loops.
+Overloads taking a pointer and `len` use variable-length arrays and are kept for compatibility.
 */
 
 /** Solves an ODE system using the 1st order Euler method */
@@ -87,5 +91,270 @@ void stepRK4(T t, T dt, T x[], int len, F f) {
 }
 
 
+
+/** Solves an ODE system using the 1st order Euler method */
+template <int N, typename T, typename F>
+void stepEuler(T t, T dt, T (&x)[N], F f) {
+	T k[N];
+
+	f(t, x, k);
+	for (int i = 0; i < N; i++) {
+		x[i] += dt * k[i];
+	}
+}
+
+/** Solves an ODE system using the 2nd order Runge-Kutta method */
+template <int N, typename T, typename F>
+void stepRK2(T t, T dt, T (&x)[N], F f) {
+	T k1[N];
+	T k2[N];
+	T yi[N];
+
+	f(t, x, k1);
+
+	for (int i = 0; i < N; i++) {
+		yi[i] = x[i] + k1[i] * dt / T(2);
+	}
+	f(t + dt / T(2), yi, k2);
+
+	for (int i = 0; i < N; i++) {
+		x[i] += dt * k2[i];
+	}
+}
+
+/** Solves an ODE system using the 4th order Runge-Kutta method */
+template <int N, typename T, typename F>
+void stepRK4(T t, T dt, T (&x)[N], F f) {
+	T k1[N];
+	T k2[N];
+	T k3[N];
+	T k4[N];
+	T yi[N];
+
+	f(t, x, k1);
+
+	for (int i = 0; i < N; i++) {
+		yi[i] = x[i] + k1[i] * dt / T(2);
+	}
+	f(t + dt / T(2), yi, k2);
+
+	for (int i = 0; i < N; i++) {
+		yi[i] = x[i] + k2[i] * dt / T(2);
+	}
+	f(t + dt / T(2), yi, k3);
+
+	for (int i = 0; i < N; i++) {
+		yi[i] = x[i] + k3[i] * dt;
+	}
+	f(t + dt, yi, k4);
+
+	for (int i = 0; i < N; i++) {
+		x[i] += dt * (k1[i] + T(2) * k2[i] + T(2) * k3[i] + k4[i]) / T(6);
+	}
+}
+
+
+/** Returns the largest absolute value of the elements. */
+inline float maxAbs(float x) {
+	return std::fabs(x);
+}
+
+inline float maxAbs(simd::float_4 x) {
+	x = simd::fabs(x);
+	return std::fmax(std::fmax(x[0], x[1]), std::fmax(x[2], x[3]));
+}
+
+#ifdef SIMD_TARGET_AVX2
+SIMD_TARGET_AVX2 inline float maxAbs(simd::float_8 x) {
+	return std::fmax(maxAbs(x.lo()), maxAbs(x.hi()));
+}
+#endif
+
+
+/** Solves an ODE system over the interval `dt` using the adaptive Cash-Karp Runge-Kutta 4(5) method.
+Takes as many substeps as needed to keep the estimated error of each substep below `tolerance`, up to `maxSteps`.
+For SIMD types, all elements share the substep size, chosen by the element with the largest error.
+`h` is the initial substep size, which is updated so it can be reused for the next call. Pass 0 to start with `dt`.
+Returns the number of substeps taken.
+*/
+template <int N, typename T, typename F>
+int stepRK45(float t, float dt, T (&x)[N], F f, float tolerance, float& h, int maxSteps = 64) {
+	// Cash-Karp tableau
+	const float a21 = 1 / 5.f;
+	const float a31 = 3 / 40.f, a32 = 9 / 40.f;
+	const float a41 = 3 / 10.f, a42 = -9 / 10.f, a43 = 6 / 5.f;
+	const float a51 = -11 / 54.f, a52 = 5 / 2.f, a53 = -70 / 27.f, a54 = 35 / 27.f;
+	const float a61 = 1631 / 55296.f, a62 = 175 / 512.f, a63 = 575 / 13824.f, a64 = 44275 / 110592.f, a65 = 253 / 4096.f;
+	const float b1 = 37 / 378.f, b3 = 250 / 621.f, b4 = 125 / 594.f, b6 = 512 / 1771.f;
+	// Differences between the 5th and 4th order weights
+	const float e1 = b1 - 2825 / 27648.f, e3 = b3 - 18575 / 48384.f, e4 = b4 - 13525 / 55296.f, e5 = -277 / 14336.f, e6 = b6 - 1 / 4.f;
+
+	if (!(h > 0.f) || h > dt)
+		h = dt;
+	float elapsed = 0.f;
+	int steps = 0;
+	while (true) {
+		// When out of steps, finish the interval in one substep regardless of error.
+		bool force = (steps >= maxSteps - 1);
+		// Take the last substep exactly to the end of the interval
+		bool last = force || (elapsed + h >= dt * (1 - 1e-6f));
+		float hs = last ? dt - elapsed : h;
+		T ts = t + elapsed;
+		T k1[N], k2[N], k3[N], k4[N], k5[N], k6[N], yi[N];
+
+		f(ts, x, k1);
+		for (int i = 0; i < N; i++)
+			yi[i] = x[i] + hs * (a21 * k1[i]);
+		f(ts + a21 * hs, yi, k2);
+		for (int i = 0; i < N; i++)
+			yi[i] = x[i] + hs * (a31 * k1[i] + a32 * k2[i]);
+		f(ts + 3 / 10.f * hs, yi, k3);
+		for (int i = 0; i < N; i++)
+			yi[i] = x[i] + hs * (a41 * k1[i] + a42 * k2[i] + a43 * k3[i]);
+		f(ts + 3 / 5.f * hs, yi, k4);
+		for (int i = 0; i < N; i++)
+			yi[i] = x[i] + hs * (a51 * k1[i] + a52 * k2[i] + a53 * k3[i] + a54 * k4[i]);
+		f(ts + hs, yi, k5);
+		for (int i = 0; i < N; i++)
+			yi[i] = x[i] + hs * (a61 * k1[i] + a62 * k2[i] + a63 * k3[i] + a64 * k4[i] + a65 * k5[i]);
+		f(ts + 7 / 8.f * hs, yi, k6);
+
+		float err = 0.f;
+		for (int i = 0; i < N; i++) {
+			T e = hs * (e1 * k1[i] + e3 * k3[i] + e4 * k4[i] + e5 * k5[i] + e6 * k6[i]);
+			err = std::fmax(err, maxAbs(e));
+		}
+
+		// Scale the next substep size by the standard 5th order controller
+		float scale = (err > 0.f) ? 0.9f * std::pow(tolerance / err, 0.2f) : 5.f;
+		scale = math::clamp(scale, 0.2f, 5.f);
+		steps++;
+
+		if (err <= tolerance || force) {
+			for (int i = 0; i < N; i++)
+				x[i] += hs * (b1 * k1[i] + b3 * k3[i] + b4 * k4[i] + b6 * k6[i]);
+			// Don't let a final substep shortened to fit the interval shrink the substep size of the next call.
+			if (!last || hs >= h)
+				h = hs * scale;
+			if (last)
+				break;
+			elapsed += hs;
+		}
+		else {
+			// Reject the substep and retry with a smaller one
+			h = hs * scale;
+		}
+	}
+	return steps;
+}
+
+
+/** Solves the linear system `A y = b` in place using Gaussian elimination without pivoting.
+`b` is replaced by the solution, and `A` is overwritten.
+Without pivoting, `A` must have a nonzero diagonal that dominates each row, which is the case for the Newton systems `I - h J` of implicit integrators when `h` is small enough.
+*/
+template <int N, typename T>
+void solveLinear(T (&A)[N][N], T (&b)[N]) {
+	// Forward elimination
+	for (int k = 0; k < N; k++) {
+		T inv = T(1) / A[k][k];
+		for (int i = k + 1; i < N; i++) {
+			T m = A[i][k] * inv;
+			for (int j = k + 1; j < N; j++)
+				A[i][j] -= m * A[k][j];
+			b[i] -= m * b[k];
+		}
+	}
+	// Back substitution
+	for (int i = N - 1; i >= 0; i--) {
+		T s = b[i];
+		for (int j = i + 1; j < N; j++)
+			s -= A[i][j] * b[j];
+		b[i] = s / A[i][i];
+	}
+}
+
+
+/** Solves the nonlinear system `g(x) = 0` using Newton-Raphson iterations, starting from the initial guess in `x`.
+The callback `g` must have the signature
+
+	void g(const T x[], T y[], T J[][N])
+
+and set `y` to `g(x)` and `J[i][j]` to the partial derivative of `y[i]` with respect to `x[j]`.
+A fixed number of iterations keeps the cost predictable in real-time code. Two or three usually suffice when starting from the previous sample's solution.
+*/
+template <int N, typename T, typename G>
+void solveNewton(T (&x)[N], G g, int iterations) {
+	for (int n = 0; n < iterations; n++) {
+		T y[N];
+		T J[N][N];
+		g(x, y, J);
+		solveLinear(J, y);
+		for (int i = 0; i < N; i++)
+			x[i] -= y[i];
+	}
+}
+
+
+/** The callback function `jacobian` for the implicit stepping functions must have the signature
+
+	void jacobian(T t, const T x[], T J[][N])
+
+and set `J[i][j]` to the partial derivative of `dxdt[i]` with respect to `x[j]`.
+*/
+
+/** Solves an ODE system using the linearly implicit (semi-implicit) Euler method.
+Solves one linear system per step instead of iterating, and remains stable for stiff systems at large timesteps, at 1st order accuracy.
+*/
+template <int N, typename T, typename F, typename J>
+void stepSemiImplicitEuler(T t, T dt, T (&x)[N], F f, J jacobian) {
+	T k[N];
+	T A[N][N];
+	f(t, x, k);
+	jacobian(t, x, A);
+	// Solve (I - dt J) dx = dt f(x)
+	for (int i = 0; i < N; i++) {
+		for (int j = 0; j < N; j++)
+			A[i][j] = -dt * A[i][j];
+		A[i][i] += T(1);
+		k[i] *= dt;
+	}
+	solveLinear(A, k);
+	for (int i = 0; i < N; i++)
+		x[i] += k[i];
+}
+
+/** Solves an ODE system using the implicit trapezoidal rule, the method behind the bilinear transform.
+2nd order accurate and A-stable, so it suits stiff circuits with fast time constants.
+The implicit equation is solved with `iterations` Newton-Raphson steps, starting from an explicit Euler guess.
+*/
+template <int N, typename T, typename F, typename J>
+void stepTrapezoidal(T t, T dt, T (&x)[N], F f, J jacobian, int iterations = 2) {
+	T k0[N];
+	T x1[N];
+	f(t, x, k0);
+	for (int i = 0; i < N; i++)
+		x1[i] = x[i] + dt * k0[i];
+
+	T t1 = t + dt;
+	T h = dt / T(2);
+	// g(x1) = x1 - x - h (f(x) + f(x1))
+	solveNewton(x1, [&](const T y[], T g[], T A[][N]) {
+		T k1[N];
+		f(t1, y, k1);
+		jacobian(t1, y, A);
+		for (int i = 0; i < N; i++) {
+			g[i] = y[i] - x[i] - h * (k0[i] + k1[i]);
+			for (int j = 0; j < N; j++)
+				A[i][j] = -h * A[i][j];
+			A[i][i] += T(1);
+		}
+	}, iterations);
+
+	for (int i = 0; i < N; i++)
+		x[i] = x1[i];
+}
+
+
 } // namespace dsp
 } // namespace rack
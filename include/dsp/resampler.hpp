@@ -54,6 +54,25 @@ struct SampleRateConverter {
 		refreshState();
 	}
 
+	/** Sets the resampling ratio to exactly `num / den` input frames per output frame, without resetting the converter.
+	Useful for adjusting the ratio continuously, e.g. to compensate for drift between two clocks.
+	The filter cutoff is still set by the rates of setRates().
+	Setters that reset the converter also reset the ratio to `inRate / outRate`, so call this again after them.
+	*/
+	void setRateFraction(uint32_t num, uint32_t den) {
+		// The converter doesn't exist when rates are equal, but a ratio near 1 still needs one.
+		if (!st) {
+			if (channels <= 0)
+				return;
+			int err;
+			st = speex_resampler_init(channels, inRate, outRate, quality, &err);
+			(void) err;
+			if (!st)
+				return;
+		}
+		speex_resampler_set_rate_frac(st, num, den, inRate, outRate);
+	}
+
 	void refreshState() {
 		if (st) {
 			speex_resampler_destroy(st);
@@ -147,6 +147,108 @@ struct DoubleRingBuffer {
 	}
 };
 
+/** Lock-free queue with a capacity chosen at runtime.
+Supports a single producer and consumer thread.
+Indices are published with release/acquire ordering, so elements written by the producer are visible to the consumer once it sees them in size().
+
+Instead of mirroring the data like DoubleRingBuffer, endData() and startData() return the contiguous region up to the wraparound point.
+Call them again after endIncr() or startIncr() to access the remainder.
+*/
+template <typename T>
+struct SpscRingBuffer {
+	T* data = NULL;
+	/** Power of 2 */
+	size_t cap = 0;
+	std::atomic<size_t> start{0};
+	std::atomic<size_t> end{0};
+
+	SpscRingBuffer() {}
+	SpscRingBuffer(const SpscRingBuffer&) = delete;
+	~SpscRingBuffer() {
+		delete[] data;
+	}
+
+	/** Reallocates the buffer to hold at least `capacity` elements and empties it.
+	Not thread-safe. Neither the producer nor the consumer may access the buffer during this call.
+	*/
+	void setCapacity(size_t capacity) {
+		size_t newCap = 1;
+		while (newCap < capacity)
+			newCap *= 2;
+		delete[] data;
+		data = new T[newCap]();
+		cap = newCap;
+		start = 0;
+		end = 0;
+	}
+	size_t getCapacity() const {
+		return cap;
+	}
+
+	size_t size() const {
+		return end.load(std::memory_order_acquire) - start.load(std::memory_order_acquire);
+	}
+	bool empty() const {
+		return size() == 0;
+	}
+	bool full() const {
+		return size() >= cap;
+	}
+	/** Returns the number of elements that can be pushed. */
+	size_t capacity() const {
+		return cap - size();
+	}
+
+	// Producer methods
+
+	/** Adds an element to the end of the buffer. The buffer must not be full. */
+	void push(T t) {
+		size_t e = end.load(std::memory_order_relaxed);
+		data[e & (cap - 1)] = t;
+		end.store(e + 1, std::memory_order_release);
+	}
+	/** Returns a pointer to consecutive free elements at the end of the buffer, and sets `n` to their count.
+	If any data is written, call endIncr() afterwards.
+	*/
+	T* endData(size_t* n) {
+		size_t e = end.load(std::memory_order_relaxed);
+		size_t s = start.load(std::memory_order_acquire);
+		size_t i = e & (cap - 1);
+		*n = std::min(cap - (e - s), cap - i);
+		return &data[i];
+	}
+	void endIncr(size_t n) {
+		end.store(end.load(std::memory_order_relaxed) + n, std::memory_order_release);
+	}
+
+	// Consumer methods
+
+	/** Removes and returns an element from the start of the buffer. The buffer must not be empty. */
+	T shift() {
+		size_t s = start.load(std::memory_order_relaxed);
+		T t = data[s & (cap - 1)];
+		start.store(s + 1, std::memory_order_release);
+		return t;
+	}
+	/** Returns a pointer to consecutive elements at the start of the buffer, and sets `n` to their count.
+	If any data is consumed, call startIncr() afterwards.
+	*/
+	const T* startData(size_t* n) const {
+		size_t s = start.load(std::memory_order_relaxed);
+		size_t e = end.load(std::memory_order_acquire);
+		size_t i = s & (cap - 1);
+		*n = std::min(e - s, cap - i);
+		return &data[i];
+	}
+	void startIncr(size_t n) {
+		start.store(start.load(std::memory_order_relaxed) + n, std::memory_order_release);
+	}
+	/** Discards all elements. Only callable by the consumer. */
+	void clear() {
+		start.store(end.load(std::memory_order_acquire), std::memory_order_release);
+	}
+};
+
 /** A cyclic buffer which maintains a valid linear array of size S by sliding along a larger block of size N.
 This is not thread-safe.
 The linear array of S elements are moved back to the start of the block once it outgrows past the end.
@@ -34,6 +34,7 @@ DEPRECATED typedef VuMeter VUMeter;
 
 /** Models a VU meter with smoothing.
 Supports peak and RMS (root-mean-square) metering.
+Use `T = float_4` to meter 4 channels at once, e.g. for polyphonic inputs.
 Usage example for a strip of lights with 3dB increments:
 ```
 // Update VuMeter state every frame.
@@ -46,14 +47,15 @@ for (int i = 0; i < 6; i++) {
 }
 ```
 */
-struct VuMeter2 {
+template <typename T = float>
+struct TVuMeter2 {
 	enum Mode {
 		PEAK,
 		RMS
 	};
 	Mode mode = PEAK;
 	/** Either the smoothed peak or the mean-square of the brightness, depending on the mode. */
-	float v = 0.f;
+	T v = 0.f;
 	/** Inverse time constant in 1/seconds */
 	float lambda = 30.f;
 
@@ -61,19 +63,39 @@ struct VuMeter2 {
 		v = 0.f;
 	}
 
-	void process(float deltaTime, float value) {
+	void process(float deltaTime, T value) {
 		if (mode == RMS) {
-			value = std::pow(value, 2);
+			value = value * value;
 			v += (value - v) * lambda * deltaTime;
 		}
 		else {
-			value = std::fabs(value);
-			if (value >= v) {
-				v = value;
+			value = simd::fabs(value);
+			v = simd::ifelse(value >= v, value, v + (value - v) * lambda * deltaTime);
+		}
+	}
+
+	/** Processes `frames` consecutive values with a single smoothing update.
+	Only the peak or mean square of the block is computed per frame, so this is several times cheaper than calling process() for each frame.
+	The result matches process() closely when the block is short compared to `1 / lambda`, e.g. one engine block or less than a screen refresh.
+	*/
+	void processBlock(float deltaTime, const T* values, int frames) {
+		if (frames <= 0)
+			return;
+		// Exact decay of the smoothing filter over the whole block
+		float a = 1.f - std::exp(-lambda * deltaTime * frames);
+		if (mode == RMS) {
+			T sum = 0.f;
+			for (int i = 0; i < frames; i++) {
+				sum += values[i] * values[i];
 			}
-			else {
-				v += (value - v) * lambda * deltaTime;
+			v += (sum / frames - v) * a;
+		}
+		else {
+			T peak = 0.f;
+			for (int i = 0; i < frames; i++) {
+				peak = simd::fmax(peak, simd::fabs(values[i]));
 			}
+			v = simd::ifelse(peak >= v, peak, v + (peak - v) * a);
 		}
 	}
 
@@ -82,17 +104,16 @@ struct VuMeter2 {
 	Set dbMin == dbMax == 0.f for a clip indicator that turns fully on when db >= dbMax.
 	Expensive, so call this infrequently.
 	*/
-	float getBrightness(float dbMin, float dbMax) {
-		float db = amplitudeToDb((mode == RMS) ? std::sqrt(v) : v);
-		if (db >= dbMax)
-			return 1.f;
-		else if (db <= dbMin)
-			return 0.f;
-		else
-			return math::rescale(db, dbMin, dbMax, 0.f, 1.f);
+	T getBrightness(float dbMin, float dbMax) {
+		T db = amplitudeToDb((mode == RMS) ? simd::sqrt(v) : v);
+		T b = simd::rescale(db, T(dbMin), T(dbMax), T(0.f), T(1.f));
+		// Select without dividing by zero for clip indicators
+		return simd::ifelse(db >= dbMax, T(1.f), simd::ifelse(db <= dbMin, T(0.f), b));
 	}
 };
 
+typedef TVuMeter2<> VuMeter2;
+
 
 } // namespace dsp
 } // namespace rack
@@ -59,7 +59,7 @@ struct Engine {
 	/** Returns the inverse of the current sample rate.
 	*/
 	float getSampleTime();
-	/** Causes worker threads to block on a mutex instead of spinlock.
+	/** Causes worker threads that finish the current frame early to park instead of spinning until this thread finishes.
 	Call this in your Module::stepBlock() method to hint that the operation will take more than ~0.1 ms.
 	*/
 	void yieldWorkers();
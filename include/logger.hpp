@@ -35,6 +35,7 @@ PRIVATE void init();
 PRIVATE void destroy();
 /** Do not use this function directly. Use the macros above.
 Thread-safe, meaning messages cannot overlap each other in the log.
+Lines are formatted on the calling thread and written to the log by a background thread shortly after, except FATAL lines which are written immediately.
 */
 __attribute__((format(printf, 5, 6)))
 void log(Level level, const char* filename, int line, const char* func, const char* format, ...);
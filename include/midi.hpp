@@ -87,6 +87,29 @@ struct Message {
 	}
 };
 
+/** Maps driver timestamps to the system::getTime() clock.
+
+Driver timestamps are intervals between messages measured by the driver, so they are accurate even when the driver delivers messages in bursts.
+The offset between the driver clock and the system clock is estimated as the minimum observed delivery delay, since messages can arrive late but never early.
+The estimate is allowed to rise slowly to follow drift between the two clocks.
+*/
+struct ClockTracker {
+	/** Maximum rate at which the estimated offset can increase, in seconds per second */
+	static constexpr double MAX_DRIFT = 0.001;
+	/** Gap between messages after which the driver clock is no longer trusted */
+	static constexpr double MAX_GAP = 1.0;
+
+	double driverTime = 0.0;
+	double offset = NAN;
+	double lastSystemTime = NAN;
+
+	/** Returns the estimated system time when a message arrived at the driver.
+	`deltaTime` is the driver's time since the previous message, and `systemTime` is when the message was delivered.
+	*/
+	PRIVATE double process(double deltaTime, double systemTime);
+	PRIVATE void reset();
+};
+
 ////////////////////
 // Driver
 ////////////////////
@@ -169,6 +192,10 @@ struct InputDevice : Device {
 	void unsubscribe(Input* input);
 	/** Called when a MIDI message is received from the device. */
 	void onMessage(const Message& message);
+	/** Called when a MIDI message is received from the device, with the time it arrived at the driver.
+	`time` is in the clock of system::getTime() and may be slightly in the past, e.g. when the driver delivers messages in bursts.
+	*/
+	void onMessage(const Message& message, double time);
 };
 
 struct OutputDevice : Device {
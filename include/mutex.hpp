@@ -51,6 +51,51 @@ struct SharedMutex {
 };
 
 
+/** Blocks threads until all `threads` threads have called wait(), then releases them together.
+
+Threads arrive up a 4-ary tree and are released down a binary tree, so each thread only touches its own cache line and those of its tree neighbors.
+A waiting thread spins for an adaptive duration based on how long its recent waits took, then parks in the kernel (using futexes on Linux) until its parent wakes it alone.
+This keeps the latency of spin-locking when all threads are busy, without burning CPU cores between audio blocks.
+*/
+struct Barrier {
+	struct Internal;
+	Internal* internal;
+
+	PRIVATE Barrier();
+	PRIVATE ~Barrier();
+	/** Must be called when no threads are calling wait(). */
+	PRIVATE void setThreads(int threads);
+	PRIVATE int getThreads();
+	/** Each of the participating threads must pass a unique `threadId` from 0 to `threads - 1`. */
+	PRIVATE void wait(int threadId);
+	/** Hints that the current phase will take a while, so waiting threads should park instead of spinning.
+	Must be called by a thread that hasn't yet arrived at the current phase.
+	*/
+	PRIVATE void yield();
+};
+
+
+/** Counting semaphore whose post() never blocks, so a real-time thread can wake another thread without taking a lock.
+
+Uses futexes on Linux, dispatch semaphores on Mac, and kernel semaphores on Windows.
+*/
+struct Semaphore {
+	struct Internal;
+	Internal* internal;
+
+	PRIVATE Semaphore();
+	PRIVATE ~Semaphore();
+	/** Increments the count, waking a waiting thread. */
+	PRIVATE void post();
+	/** Blocks until the count is positive, then decrements it. */
+	PRIVATE void wait();
+	/** Like wait() but gives up after `duration` seconds.
+	Returns whether the count was decremented.
+	*/
+	PRIVATE bool waitFor(double duration);
+};
+
+
 template <class TMutex>
 struct SharedLock {
 	TMutex& m;
@@ -1,10 +1,19 @@
 #pragma once
+#include <set>
+
 #include <jansson.h>
 
 #include <common.hpp>
 
 
 namespace rack {
+
+
+namespace plugin {
+struct Model;
+} // namespace plugin
+
+
 /** Handles the Rack patch file state */
 namespace patch {
 
@@ -62,6 +71,8 @@ struct Manager {
 	json_t* toJson();
 	void fromJson(json_t* rootJ);
 	void log(std::string msg);
+	/** Remembers the SVGs loaded by a Model's ModuleWidget, so later patches using the Model can preload them. */
+	PRIVATE void setModelSvgs(plugin::Model* model, const std::set<std::string>& filenames);
 };
 
 
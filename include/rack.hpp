@@ -24,6 +24,7 @@ Directly including Rack headers other than rack.hpp in your plugin is unsupporte
 #include <string.hpp>
 #include <system.hpp>
 #include <mutex.hpp>
+#include <trace.hpp>
 #include <random.hpp>
 #include <network.hpp>
 #include <asset.hpp>
@@ -124,6 +125,7 @@ Directly including Rack headers other than rack.hpp in your plugin is unsupporte
 
 #include <simd/Vector.hpp>
 #include <simd/functions.hpp>
+#include <simd/cpu.hpp>
 
 
 namespace rack {
@@ -1,5 +1,7 @@
 #pragma once
 #include <common.hpp>
+#include <simd/Vector.hpp>
+#include <simd/functions.hpp>
 #include <random>
 #include <vector>
 
@@ -58,15 +60,44 @@ struct Xoroshiro128Plus {
 	constexpr uint64_t max() const {
 		return UINT64_MAX;
 	}
+
+	/** Advances the state by 2^64 steps.
+	Calling this between seeding generators gives each one a non-overlapping sequence.
+	*/
+	void jump() {
+		static const uint64_t JUMP[] = {0xbeac0467eba5facb, 0xd86b048b86aa9922};
+		uint64_t s0 = 0;
+		uint64_t s1 = 0;
+		for (int i = 0; i < 2; i++) {
+			for (int b = 0; b < 64; b++) {
+				if (JUMP[i] & (uint64_t(1) << b)) {
+					s0 ^= state[0];
+					s1 ^= state[1];
+				}
+				operator()();
+			}
+		}
+		state[0] = s0;
+		state[1] = s1;
+	}
 };
 
 
 // Simple global API
 
+/** Seeds the calling thread's generator, unless it was already seeded after the last call to seed().
+Call this at the start of each thread that uses the random API, and periodically if the thread should follow changes to the master seed.
+*/
 void init();
 
-/** Returns the generator.
-Named "local" because the generator was thread-local in previous versions.
+/** Sets the master seed from which each thread's generator is derived, and makes threads reseed on their next call to init().
+Each thread receives a separate non-overlapping stream in the order threads call init().
+Results are reproducible if threads are initialized in the same order and the same work runs on each thread, e.g. when rendering with a single engine thread.
+If never called, the master seed is taken from the system clock.
+*/
+void seed(uint64_t s);
+
+/** Returns the calling thread's generator.
 */
 Xoroshiro128Plus& local();
 
@@ -155,5 +186,81 @@ inline std::vector<uint8_t> vector(size_t len) {
 }
 
 
+/** Four independent xoshiro128+ generators running in parallel SIMD lanes.
+Generates a `float_4` of uniform or normal values in about the time a scalar generator produces one.
+From https://prng.di.unimi.it/
+
+Since the lowest bits of xoshiro128+ have low linear complexity, only the upper 24 bits are used for floats.
+
+Example:
+
+	random::Xoshiro128Plus_4 rng;
+	rng.seed();
+	simd::float_4 noise = rng.normal();
+*/
+struct Xoshiro128Plus_4 {
+	simd::int32_4 state[4];
+	simd::float_4 spare;
+	bool hasSpare = false;
+
+	/** Seeds all lanes from the calling thread's generator. */
+	void seed() {
+		seed(local());
+	}
+
+	void seed(Xoroshiro128Plus& rng) {
+		for (int i = 0; i < 4; i++) {
+			for (int j = 0; j < 4; j++) {
+				// Avoid the all-zero state, which only produces zeros.
+				uint32_t r;
+				while ((r = rng() >> 32) == 0) {}
+				state[i].s[j] = r;
+			}
+		}
+		hasSpare = false;
+	}
+
+	static simd::int32_4 rotl(simd::int32_4 x, int k) {
+		return (x << k) | (x >> (32 - k));
+	}
+
+	simd::int32_4 operator()() {
+		simd::int32_4 result = state[0] + state[3];
+		simd::int32_4 t = state[1] << 9;
+
+		state[2] ^= state[0];
+		state[3] ^= state[1];
+		state[1] ^= state[2];
+		state[0] ^= state[3];
+		state[2] ^= t;
+		state[3] = rotl(state[3], 11);
+
+		return result;
+	}
+
+	/** Returns uniform random floats in the interval [0.0, 1.0) */
+	simd::float_4 uniform() {
+		return simd::float_4(operator()() >> 8) * (1.f / (1 << 24));
+	}
+
+	/** Returns normal random floats with mean 0 and standard deviation 1.
+	Uses the Box-Muller transform, which gives two vectors at a time, so every other call is nearly free.
+	*/
+	simd::float_4 normal() {
+		if (hasSpare) {
+			hasSpare = false;
+			return spare;
+		}
+		simd::float_4 radius = simd::sqrt(-2.f * simd::log(1.f - uniform()));
+		simd::float_4 theta = float(2 * M_PI) * uniform();
+		simd::float_4 s, c;
+		simd::sincos(theta, &s, &c);
+		spare = radius * c;
+		hasSpare = true;
+		return radius * s;
+	}
+};
+
+
 } // namespace random
 } // namespace rack
@@ -0,0 +1,174 @@
+#pragma once
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+
+#include <common.hpp>
+
+
+namespace rack {
+
+
+/** A list that real-time threads can iterate without locking while other threads replace it.
+
+Readers never block or allocate.
+Writers publish a new copy of the list and then wait until every reader that could still see the old copy has finished, so items removed from the list can be destroyed as soon as set() returns.
+This is a minimal read-copy-update scheme with two reader counters that alternate between epochs.
+
+Example:
+
+	RcuList<Port*> list;
+	// Writer thread
+	list.set({port1, port2});
+	// Reader thread
+	{
+		RcuList<Port*>::Reader reader(list);
+		for (Port* port : reader) {
+			...
+		}
+	}
+
+A writer must not call set() while it is also reading the same list, since it would wait for itself.
+*/
+template <typename T>
+struct RcuList {
+	std::atomic<std::vector<T>*> current;
+	std::atomic<uint32_t> epoch{0};
+	std::atomic<int> readers[2];
+	std::mutex writeMutex;
+
+	RcuList() {
+		current = new std::vector<T>;
+		readers[0] = 0;
+		readers[1] = 0;
+	}
+	~RcuList() {
+		delete current.load();
+	}
+
+	/** Replaces the list and waits until no reader is using the old one. */
+	void set(const std::vector<T>& items) {
+		std::lock_guard<std::mutex> lock(writeMutex);
+		std::vector<T>* old = current.exchange(new std::vector<T>(items));
+		synchronize();
+		delete old;
+	}
+
+	/** Waits until all readers that started before the call have finished.
+	Readers register with the counter of the epoch they observed, so two epoch flips are needed to be sure no reader registered with either counter is still using the old list.
+	*/
+	void synchronize() {
+		for (int i = 0; i < 2; i++) {
+			uint32_t e = epoch.fetch_add(1);
+			while (readers[e & 1] != 0)
+				std::this_thread::yield();
+		}
+	}
+
+	/** Scoped read access to the list */
+	struct Reader {
+		RcuList& list;
+		uint32_t e;
+		const std::vector<T>* items;
+
+		Reader(RcuList& list) : list(list) {
+			while (true) {
+				e = list.epoch;
+				list.readers[e & 1]++;
+				// If the epoch flipped before we registered, the writer might not be waiting on our counter, so register again.
+				if (list.epoch == e)
+					break;
+				list.readers[e & 1]--;
+			}
+			items = list.current;
+		}
+		~Reader() {
+			list.readers[e & 1]--;
+		}
+
+		typename std::vector<T>::const_iterator begin() const {
+			return items->begin();
+		}
+		typename std::vector<T>::const_iterator end() const {
+			return items->end();
+		}
+		bool empty() const {
+			return items->empty();
+		}
+	};
+};
+
+
+/** Lists keyed by owner, such as the subscribers of each device, that real-time threads can iterate without locking.
+
+Keeping the lists in one table outside of their owners lets structs shared with plugins keep their layout.
+An owner's entry is removed when its list becomes empty, so nothing is left behind when the owner is destroyed afterward.
+
+Example:
+
+	static RcuListMap<const Device*, Port*> devicePorts;
+	// Writer thread
+	devicePorts.set(device, {port1, port2});
+	// Reader thread
+	{
+		RcuListMap<const Device*, Port*>::Reader reader(devicePorts, device);
+		for (Port* port : reader) {
+			...
+		}
+	}
+*/
+template <typename K, typename T>
+struct RcuListMap {
+	typedef std::pair<K, std::vector<T>> Entry;
+	RcuList<Entry> entries;
+	/** Serializes set() calls, since each one copies the table before replacing it. */
+	std::mutex writeMutex;
+	/** Returned by readers of owners without an entry */
+	const std::vector<T> emptyItems;
+
+	/** Replaces the list of `key` and waits until no reader is using the old one. */
+	void set(K key, const std::vector<T>& items) {
+		std::lock_guard<std::mutex> lock(writeMutex);
+		std::vector<Entry> newEntries;
+		{
+			typename RcuList<Entry>::Reader reader(entries);
+			for (const Entry& entry : reader) {
+				if (entry.first != key)
+					newEntries.push_back(entry);
+			}
+		}
+		if (!items.empty())
+			newEntries.push_back(Entry(key, items));
+		entries.set(newEntries);
+	}
+
+	/** Scoped read access to the list of one owner */
+	struct Reader {
+		typename RcuList<Entry>::Reader reader;
+		const std::vector<T>* items;
+
+		Reader(RcuListMap& map, K key) : reader(map.entries) {
+			items = &map.emptyItems;
+			for (const Entry& entry : reader) {
+				if (entry.first == key) {
+					items = &entry.second;
+					break;
+				}
+			}
+		}
+
+		typename std::vector<T>::const_iterator begin() const {
+			return items->begin();
+		}
+		typename std::vector<T>::const_iterator end() const {
+			return items->end();
+		}
+		bool empty() const {
+			return items->empty();
+		}
+	};
+};
+
+
+} // namespace rack
@@ -72,6 +72,18 @@ extern bool squeezeModules;
 extern bool preferDarkPanels;
 /** Maximum screen redraw frequency in Hz, or 0 for unlimited. */
 extern float frameRateLimit;
+/** Maximum screen redraw frequency in Hz while idle, or 0 (off) to use `frameRateLimit`.
+The window is idle after `idleTimeout` seconds without input events or visible changes of module lights and params.
+*/
+extern float idleFrameRateLimit;
+extern float idleTimeout;
+/** Maximum screen redraw frequency in Hz while the window is unfocused or hidden, or 0 (off) to use `frameRateLimit`. */
+extern float backgroundFrameRateLimit;
+/** Maximum total size of cached framebuffers in megapixels, or 0 for unlimited.
+Least recently drawn framebuffers are deleted when this is exceeded and re-rendered when they are drawn again.
+Visible framebuffers are never deleted, so the budget is exceeded when they alone need more.
+*/
+extern float framebufferBudget;
 /** Interval between autosaves in seconds. */
 extern float autosaveInterval;
 extern bool skipLoadOnLaunch;
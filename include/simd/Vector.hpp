@@ -333,11 +333,324 @@ inline Vector<int32_t, 4> operator>>(const Vector<int32_t, 4>& a, const int& b)
 }
 
 
+#ifdef SIMD_TARGET_AVX2
+/* 8-element vectors are compiled for AVX2 per function with SIMD_TARGET_AVX2, so they can be used in any source file without raising its baseline instruction set.
+Use them only in functions marked SIMD_TARGET_AVX2, and call those only after checking `simd::hasAvx2()`.
+See <simd/cpu.hpp>.
+*/
+
+
+/** `__m256` and `__m256i` with 16-byte alignment.
+Without AVX enabled, compilers align `__m256` to 16 bytes, so 8-element vectors use these to have the same layout in every translation unit.
+This also lets them live in memory from `new` and `malloc()`, which only guarantee 16-byte alignment in C++11.
+*/
+typedef float m256_a16 __attribute__((vector_size(32), aligned(16)));
+typedef long long m256i_a16 __attribute__((vector_size(32), aligned(16)));
+
+
+/** Wrapper for `__m256` representing an 8-element vector of single-precision float values.
+*/
+template <>
+struct Vector<float, 8> {
+	using type = float;
+	constexpr static int size = 8;
+
+	union {
+		m256_a16 v;
+		/** Accessing this array of scalars is slow and defeats the purpose of vectorizing.
+		*/
+		float s[8];
+	};
+
+	/** Constructs an uninitialized vector. */
+	Vector() = default;
+
+	/** Constructs a vector from a native `__m256` type. */
+	SIMD_TARGET_AVX2 Vector(__m256 v) : v(v) {}
+
+	/** Constructs a vector with all elements set to `x`. */
+	SIMD_TARGET_AVX2 Vector(float x) {
+		v = _mm256_set1_ps(x);
+	}
+
+	/** Constructs a vector from eight scalars. */
+	SIMD_TARGET_AVX2 Vector(float x1, float x2, float x3, float x4, float x5, float x6, float x7, float x8) {
+		v = _mm256_setr_ps(x1, x2, x3, x4, x5, x6, x7, x8);
+	}
+
+	/** Constructs a vector from two 4-element halves. */
+	SIMD_TARGET_AVX2 Vector(Vector<float, 4> lo, Vector<float, 4> hi) {
+		v = _mm256_insertf128_ps(_mm256_castps128_ps256(lo.v), hi.v, 1);
+	}
+
+	/** Returns a vector with all 0 bits. */
+	SIMD_TARGET_AVX2 static Vector zero() {
+		return Vector(_mm256_setzero_ps());
+	}
+
+	/** Returns a vector with all 1 bits. */
+	SIMD_TARGET_AVX2 static Vector mask() {
+		return Vector(_mm256_castsi256_ps(_mm256_set1_epi32(-1)));
+	}
+
+	/** Reads an array of 8 values. */
+	SIMD_TARGET_AVX2 static Vector load(const float* x) {
+		return Vector(_mm256_loadu_ps(x));
+	}
+
+	/** Writes an array of 8 values. */
+	SIMD_TARGET_AVX2 void store(float* x) {
+		_mm256_storeu_ps(x, v);
+	}
+
+	/** Returns elements 0-3. */
+	SIMD_TARGET_AVX2 Vector<float, 4> lo() const {
+		return Vector<float, 4>(_mm256_castps256_ps128(v));
+	}
+
+	/** Returns elements 4-7. */
+	SIMD_TARGET_AVX2 Vector<float, 4> hi() const {
+		return Vector<float, 4>(_mm256_extractf128_ps(v, 1));
+	}
+
+	SIMD_TARGET_AVX2 float& operator[](int i) {
+		return s[i];
+	}
+	SIMD_TARGET_AVX2 const float& operator[](int i) const {
+		return s[i];
+	}
+
+	// Conversions
+	SIMD_TARGET_AVX2 Vector(Vector<int32_t, 8> a);
+	// Casts
+	SIMD_TARGET_AVX2 static Vector cast(Vector<int32_t, 8> a);
+};
+
+
+template <>
+struct Vector<int32_t, 8> {
+	using type = int32_t;
+	constexpr static int size = 8;
+
+	union {
+		m256i_a16 v;
+		int32_t s[8];
+	};
+
+	Vector() = default;
+	SIMD_TARGET_AVX2 Vector(__m256i v) : v(v) {}
+	SIMD_TARGET_AVX2 Vector(int32_t x) {
+		v = _mm256_set1_epi32(x);
+	}
+	SIMD_TARGET_AVX2 Vector(int32_t x1, int32_t x2, int32_t x3, int32_t x4, int32_t x5, int32_t x6, int32_t x7, int32_t x8) {
+		v = _mm256_setr_epi32(x1, x2, x3, x4, x5, x6, x7, x8);
+	}
+	SIMD_TARGET_AVX2 Vector(Vector<int32_t, 4> lo, Vector<int32_t, 4> hi) {
+		v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo.v), hi.v, 1);
+	}
+	SIMD_TARGET_AVX2 static Vector zero() {
+		return Vector(_mm256_setzero_si256());
+	}
+	SIMD_TARGET_AVX2 static Vector mask() {
+		return Vector(_mm256_set1_epi32(-1));
+	}
+	SIMD_TARGET_AVX2 static Vector load(const int32_t* x) {
+		return Vector(_mm256_loadu_si256((const __m256i*) x));
+	}
+	SIMD_TARGET_AVX2 void store(int32_t* x) {
+		_mm256_storeu_si256((__m256i*) x, v);
+	}
+	SIMD_TARGET_AVX2 Vector<int32_t, 4> lo() const {
+		return Vector<int32_t, 4>(_mm256_castsi256_si128(v));
+	}
+	SIMD_TARGET_AVX2 Vector<int32_t, 4> hi() const {
+		return Vector<int32_t, 4>(_mm256_extracti128_si256(v, 1));
+	}
+	SIMD_TARGET_AVX2 int32_t& operator[](int i) {
+		return s[i];
+	}
+	SIMD_TARGET_AVX2 const int32_t& operator[](int i) const {
+		return s[i];
+	}
+	SIMD_TARGET_AVX2 Vector(Vector<float, 8> a);
+	SIMD_TARGET_AVX2 static Vector cast(Vector<float, 8> a);
+};
+
+
+SIMD_TARGET_AVX2 inline Vector<float, 8>::Vector(Vector<int32_t, 8> a) {
+	v = _mm256_cvtepi32_ps(a.v);
+}
+
+SIMD_TARGET_AVX2 inline Vector<int32_t, 8>::Vector(Vector<float, 8> a) {
+	v = _mm256_cvttps_epi32(a.v);
+}
+
+SIMD_TARGET_AVX2 inline Vector<float, 8> Vector<float, 8>::cast(Vector<int32_t, 8> a) {
+	return Vector(_mm256_castsi256_ps(a.v));
+}
+
+SIMD_TARGET_AVX2 inline Vector<int32_t, 8> Vector<int32_t, 8>::cast(Vector<float, 8> a) {
+	return Vector(_mm256_castps_si256(a.v));
+}
+
+
+SIMD_TARGET_AVX2 DECLARE_VECTOR_OPERATOR_INFIX(float, 8, operator+, _mm256_add_ps)
+SIMD_TARGET_AVX2 DECLARE_VECTOR_OPERATOR_INFIX(int32_t, 8, operator+, _mm256_add_epi32)
+
+SIMD_TARGET_AVX2 DECLARE_VECTOR_OPERATOR_INFIX(float, 8, operator-, _mm256_sub_ps)
+SIMD_TARGET_AVX2 DECLARE_VECTOR_OPERATOR_INFIX(int32_t, 8, operator-, _mm256_sub_epi32)
+
+SIMD_TARGET_AVX2 DECLARE_VECTOR_OPERATOR_INFIX(float, 8, operator*, _mm256_mul_ps)
+
+SIMD_TARGET_AVX2 DECLARE_VECTOR_OPERATOR_INFIX(float, 8, operator/, _mm256_div_ps)
+
+SIMD_TARGET_AVX2 DECLARE_VECTOR_OPERATOR_INFIX(float, 8, operator^, _mm256_xor_ps)
+SIMD_TARGET_AVX2 DECLARE_VECTOR_OPERATOR_INFIX(int32_t, 8, operator^, _mm256_xor_si256)
+
+SIMD_TARGET_AVX2 DECLARE_VECTOR_OPERATOR_INFIX(float, 8, operator&, _mm256_and_ps)
+SIMD_TARGET_AVX2 DECLARE_VECTOR_OPERATOR_INFIX(int32_t, 8, operator&, _mm256_and_si256)
+
+SIMD_TARGET_AVX2 DECLARE_VECTOR_OPERATOR_INFIX(float, 8, operator|, _mm256_or_ps)
+SIMD_TARGET_AVX2 DECLARE_VECTOR_OPERATOR_INFIX(int32_t, 8, operator|, _mm256_or_si256)
+
+SIMD_TARGET_AVX2 DECLARE_VECTOR_OPERATOR_INCREMENT(float, 8, operator+=, operator+)
+SIMD_TARGET_AVX2 DECLARE_VECTOR_OPERATOR_INCREMENT(int32_t, 8, operator+=, operator+)
+
+SIMD_TARGET_AVX2 DECLARE_VECTOR_OPERATOR_INCREMENT(float, 8, operator-=, operator-)
+SIMD_TARGET_AVX2 DECLARE_VECTOR_OPERATOR_INCREMENT(int32_t, 8, operator-=, operator-)
+
+SIMD_TARGET_AVX2 DECLARE_VECTOR_OPERATOR_INCREMENT(float, 8, operator*=, operator*)
+
+SIMD_TARGET_AVX2 DECLARE_VECTOR_OPERATOR_INCREMENT(float, 8, operator/=, operator/)
+
+SIMD_TARGET_AVX2 DECLARE_VECTOR_OPERATOR_INCREMENT(float, 8, operator^=, operator^)
+SIMD_TARGET_AVX2 DECLARE_VECTOR_OPERATOR_INCREMENT(int32_t, 8, operator^=, operator^)
+
+SIMD_TARGET_AVX2 DECLARE_VECTOR_OPERATOR_INCREMENT(float, 8, operator&=, operator&)
+SIMD_TARGET_AVX2 DECLARE_VECTOR_OPERATOR_INCREMENT(int32_t, 8, operator&=, operator&)
+
+SIMD_TARGET_AVX2 DECLARE_VECTOR_OPERATOR_INCREMENT(float, 8, operator|=, operator|)
+SIMD_TARGET_AVX2 DECLARE_VECTOR_OPERATOR_INCREMENT(int32_t, 8, operator|=, operator|)
+
+// These predicates give the same results as the SSE comparisons, including for NaN.
+SIMD_TARGET_AVX2 inline Vector<float, 8> operator==(const Vector<float, 8>& a, const Vector<float, 8>& b) {
+	return Vector<float, 8>(_mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ));
+}
+SIMD_TARGET_AVX2 inline Vector<int32_t, 8> operator==(const Vector<int32_t, 8>& a, const Vector<int32_t, 8>& b) {
+	return Vector<int32_t, 8>(_mm256_cmpeq_epi32(a.v, b.v));
+}
+
+SIMD_TARGET_AVX2 inline Vector<float, 8> operator>=(const Vector<float, 8>& a, const Vector<float, 8>& b) {
+	return Vector<float, 8>(_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ));
+}
+SIMD_TARGET_AVX2 inline Vector<int32_t, 8> operator>=(const Vector<int32_t, 8>& a, const Vector<int32_t, 8>& b) {
+	return Vector<int32_t, 8>(_mm256_cmpgt_epi32(b.v, a.v)) ^ Vector<int32_t, 8>::mask();
+}
+
+SIMD_TARGET_AVX2 inline Vector<float, 8> operator>(const Vector<float, 8>& a, const Vector<float, 8>& b) {
+	return Vector<float, 8>(_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ));
+}
+SIMD_TARGET_AVX2 inline Vector<int32_t, 8> operator>(const Vector<int32_t, 8>& a, const Vector<int32_t, 8>& b) {
+	return Vector<int32_t, 8>(_mm256_cmpgt_epi32(a.v, b.v));
+}
+
+SIMD_TARGET_AVX2 inline Vector<float, 8> operator<=(const Vector<float, 8>& a, const Vector<float, 8>& b) {
+	return Vector<float, 8>(_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ));
+}
+SIMD_TARGET_AVX2 inline Vector<int32_t, 8> operator<=(const Vector<int32_t, 8>& a, const Vector<int32_t, 8>& b) {
+	return Vector<int32_t, 8>(_mm256_cmpgt_epi32(a.v, b.v)) ^ Vector<int32_t, 8>::mask();
+}
+
+SIMD_TARGET_AVX2 inline Vector<float, 8> operator<(const Vector<float, 8>& a, const Vector<float, 8>& b) {
+	return Vector<float, 8>(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ));
+}
+SIMD_TARGET_AVX2 inline Vector<int32_t, 8> operator<(const Vector<int32_t, 8>& a, const Vector<int32_t, 8>& b) {
+	return Vector<int32_t, 8>(_mm256_cmpgt_epi32(b.v, a.v));
+}
+
+SIMD_TARGET_AVX2 inline Vector<float, 8> operator!=(const Vector<float, 8>& a, const Vector<float, 8>& b) {
+	return Vector<float, 8>(_mm256_cmp_ps(a.v, b.v, _CMP_NEQ_UQ));
+}
+SIMD_TARGET_AVX2 inline Vector<int32_t, 8> operator!=(const Vector<int32_t, 8>& a, const Vector<int32_t, 8>& b) {
+	return Vector<int32_t, 8>(_mm256_cmpeq_epi32(a.v, b.v)) ^ Vector<int32_t, 8>::mask();
+}
+
+SIMD_TARGET_AVX2 inline Vector<float, 8> operator+(const Vector<float, 8>& a) {
+	return a;
+}
+SIMD_TARGET_AVX2 inline Vector<int32_t, 8> operator+(const Vector<int32_t, 8>& a) {
+	return a;
+}
+
+SIMD_TARGET_AVX2 inline Vector<float, 8> operator-(const Vector<float, 8>& a) {
+	return 0.f - a;
+}
+SIMD_TARGET_AVX2 inline Vector<int32_t, 8> operator-(const Vector<int32_t, 8>& a) {
+	return 0 - a;
+}
+
+SIMD_TARGET_AVX2 inline Vector<float, 8>& operator++(Vector<float, 8>& a) {
+	return a += 1.f;
+}
+SIMD_TARGET_AVX2 inline Vector<int32_t, 8>& operator++(Vector<int32_t, 8>& a) {
+	return a += 1;
+}
+
+SIMD_TARGET_AVX2 inline Vector<float, 8>& operator--(Vector<float, 8>& a) {
+	return a -= 1.f;
+}
+SIMD_TARGET_AVX2 inline Vector<int32_t, 8>& operator--(Vector<int32_t, 8>& a) {
+	return a -= 1;
+}
+
+SIMD_TARGET_AVX2 inline Vector<float, 8> operator++(Vector<float, 8>& a, int) {
+	Vector<float, 8> b = a;
+	++a;
+	return b;
+}
+SIMD_TARGET_AVX2 inline Vector<int32_t, 8> operator++(Vector<int32_t, 8>& a, int) {
+	Vector<int32_t, 8> b = a;
+	++a;
+	return b;
+}
+
+SIMD_TARGET_AVX2 inline Vector<float, 8> operator--(Vector<float, 8>& a, int) {
+	Vector<float, 8> b = a;
+	--a;
+	return b;
+}
+SIMD_TARGET_AVX2 inline Vector<int32_t, 8> operator--(Vector<int32_t, 8>& a, int) {
+	Vector<int32_t, 8> b = a;
+	--a;
+	return b;
+}
+
+SIMD_TARGET_AVX2 inline Vector<float, 8> operator~(const Vector<float, 8>& a) {
+	return a ^ Vector<float, 8>::mask();
+}
+SIMD_TARGET_AVX2 inline Vector<int32_t, 8> operator~(const Vector<int32_t, 8>& a) {
+	return a ^ Vector<int32_t, 8>::mask();
+}
+
+SIMD_TARGET_AVX2 inline Vector<int32_t, 8> operator<<(const Vector<int32_t, 8>& a, const int& b) {
+	return Vector<int32_t, 8>(_mm256_sll_epi32(a.v, _mm_cvtsi32_si128(b)));
+}
+
+SIMD_TARGET_AVX2 inline Vector<int32_t, 8> operator>>(const Vector<int32_t, 8>& a, const int& b) {
+	return Vector<int32_t, 8>(_mm256_srl_epi32(a.v, _mm_cvtsi32_si128(b)));
+}
+#endif
+
+
 // Typedefs
 
 
 using float_4 = Vector<float, 4>;
 using int32_4 = Vector<int32_t, 4>;
+#ifdef SIMD_TARGET_AVX2
+using float_8 = Vector<float, 8>;
+using int32_8 = Vector<int32_t, 8>;
+#endif
 
 
 } // namespace simd
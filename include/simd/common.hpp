@@ -6,3 +6,15 @@
 	#define SIMDE_ENABLE_NATIVE_ALIASES
 	#include <simde/x86/sse4.2.h>
 #endif
+
+#if defined __SSE4_2__ && (defined __GNUC__ || defined __clang__)
+	// Declares AVX intrinsics regardless of the compiler's instruction set flags, for use in functions marked with the target attributes below.
+	#include <immintrin.h>
+
+	/** Compiles a function with AVX2 and FMA enabled, leaving the rest of the translation unit at the baseline instruction set.
+	Functions using float_8 must be marked with this.
+	*/
+	#define SIMD_TARGET_AVX2 __attribute__((target("avx2,fma")))
+	/** Compiles a function with the AVX-512 F, VL, BW, and DQ subsets enabled, in addition to AVX2 and FMA. */
+	#define SIMD_TARGET_AVX512 __attribute__((target("avx2,fma,avx512f,avx512vl,avx512bw,avx512dq")))
+#endif
@@ -0,0 +1,79 @@
+#pragma once
+#include <common.hpp>
+#include "common.hpp"
+
+
+namespace rack {
+namespace simd {
+
+
+/** Runtime CPU feature detection for selecting SIMD kernels.
+
+Rack and plugins are compiled for a baseline instruction set (SSE4.2 on x86_64).
+To use wider vectors such as `float_8`, mark the kernel with SIMD_TARGET_AVX2 (or SIMD_TARGET_AVX512), which compiles only that function with those instruction sets enabled.
+Then choose the implementation once, e.g. when the module is constructed, and call it through a function pointer.
+
+Example:
+
+	SIMD_TARGET_AVX2 __attribute__((flatten))
+	void processFilterAvx2(float* x, int n) {
+		for (int i = 0; i < n; i += 8) {
+			simd::float_8 v = simd::float_8::load(&x[i]);
+			...
+		}
+	}
+
+	void processFilterGeneric(float* x, int n) {...}
+
+	processFilter = simd::dispatch(processFilterGeneric, processFilterAvx2);
+
+Do not compile whole source files with `-mavx2` or similar flags.
+Every inline function and template such a file uses, including those from Rack's headers and the C++ standard library, would get an AVX copy that the linker may pick for callers in baseline code, crashing on older CPUs.
+
+Templates such as `dsp::exp2_taylor5()` instantiated with `float_8` are compiled for the baseline instruction set, so `flatten` is recommended to inline them into the kernel.
+*/
+inline bool hasAvx2() {
+#if defined ARCH_X64 && (defined __GNUC__ || defined __clang__)
+	static const bool has = []() {
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	}();
+	return has;
+#else
+	return false;
+#endif
+}
+
+/** Returns whether the CPU supports the AVX-512 F, VL, BW, and DQ subsets, which SIMD_TARGET_AVX512 enables. */
+inline bool hasAvx512() {
+#if defined ARCH_X64 && (defined __GNUC__ || defined __clang__)
+	static const bool has = []() {
+		__builtin_cpu_init();
+		return hasAvx2()
+			&& __builtin_cpu_supports("avx512f")
+			&& __builtin_cpu_supports("avx512vl")
+			&& __builtin_cpu_supports("avx512bw")
+			&& __builtin_cpu_supports("avx512dq");
+	}();
+	return has;
+#else
+	return false;
+#endif
+}
+
+
+/** Returns the fastest implementation supported by the CPU.
+Pass NULL for implementations that don't exist.
+*/
+template <typename F>
+F* dispatch(F* generic, F* avx2, F* avx512 = NULL) {
+	if (avx512 && hasAvx512())
+		return avx512;
+	if (avx2 && hasAvx2())
+		return avx2;
+	return generic;
+}
+
+
+} // namespace simd
+} // namespace rack
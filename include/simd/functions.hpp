@@ -113,13 +113,13 @@ inline float_4 log(float_4 x) {
 using std::log10;
 
 inline float_4 log10(float_4 x) {
-	return float_4(sse_mathfun_log_ps(x.v)) / std::log(10.f);
+	return float_4(sse_mathfun_log_ps(x.v)) * float(M_LOG10E);
 }
 
 using std::log2;
 
 inline float_4 log2(float_4 x) {
-	return float_4(sse_mathfun_log_ps(x.v)) / std::log(2.f);
+	return float_4(sse_mathfun_log_ps(x.v)) * float(M_LOG2E);
 }
 
 using std::exp;
@@ -128,6 +128,12 @@ inline float_4 exp(float_4 x) {
 	return float_4(sse_mathfun_exp_ps(x.v));
 }
 
+using std::exp2;
+
+inline float_4 exp2(float_4 x) {
+	return float_4(sse_mathfun_exp_ps((x * float(M_LN2)).v));
+}
+
 using std::sin;
 
 inline float_4 sin(float_4 x) {
@@ -140,6 +146,18 @@ inline float_4 cos(float_4 x) {
 	return float_4(sse_mathfun_cos_ps(x.v));
 }
 
+/** Computes `sin(x)` and `cos(x)`.
+For vectors, this shares the range reduction and costs little more than calling either one.
+*/
+inline void sincos(float x, float* s, float* c) {
+	*s = std::sin(x);
+	*c = std::cos(x);
+}
+
+inline void sincos(float_4 x, float_4* s, float_4* c) {
+	sse_mathfun_sincos_ps(x.v, &s->v, &c->v);
+}
+
 using std::tan;
 
 inline float_4 tan(float_4 x) {
@@ -274,5 +292,182 @@ inline float_4 sgn(float_4 x) {
 }
 
 
+#ifdef SIMD_TARGET_AVX2
+// 8-element versions of the above functions.
+// Functions without an AVX instruction are computed on each 4-element half.
+
+/** Applies a 4-element function to both halves of an 8-element vector. */
+#define SIMD_FUNCTION_HALVES_1(f, a) \
+	float_8(f((a).lo()), f((a).hi()))
+#define SIMD_FUNCTION_HALVES_2(f, a, b) \
+	float_8(f((a).lo(), (b).lo()), f((a).hi(), (b).hi()))
+
+SIMD_TARGET_AVX2 inline float_8 andnot(float_8 a, float_8 b) {
+	return float_8(_mm256_andnot_ps(a.v, b.v));
+}
+
+SIMD_TARGET_AVX2 inline int movemask(float_8 a) {
+	return _mm256_movemask_ps(a.v);
+}
+
+SIMD_TARGET_AVX2 inline int movemask(int32_8 a) {
+	return _mm256_movemask_ps(_mm256_castsi256_ps(a.v));
+}
+
+SIMD_TARGET_AVX2 inline float_8 rsqrt(float_8 x) {
+	return float_8(_mm256_rsqrt_ps(x.v));
+}
+
+SIMD_TARGET_AVX2 inline float_8 rcp(float_8 x) {
+	return float_8(_mm256_rcp_ps(x.v));
+}
+
+SIMD_TARGET_AVX2 inline float_8 ifelse(float_8 mask, float_8 a, float_8 b) {
+	return float_8(_mm256_blendv_ps(b.v, a.v, mask.v));
+}
+
+template <>
+SIMD_TARGET_AVX2 inline int32_8 movemaskInverse<int32_8>(int a) {
+	int32_8 mask = int32_8(1, 2, 4, 8, 16, 32, 64, 128);
+	return (mask & int32_8(a)) == mask;
+}
+
+template <>
+SIMD_TARGET_AVX2 inline float_8 movemaskInverse<float_8>(int a) {
+	return float_8::cast(movemaskInverse<int32_8>(a));
+}
+
+SIMD_TARGET_AVX2 inline float_8 fmax(float_8 x, float_8 b) {
+	return float_8(_mm256_max_ps(x.v, b.v));
+}
+
+SIMD_TARGET_AVX2 inline float_8 fmin(float_8 x, float_8 b) {
+	return float_8(_mm256_min_ps(x.v, b.v));
+}
+
+SIMD_TARGET_AVX2 inline float_8 sqrt(float_8 x) {
+	return float_8(_mm256_sqrt_ps(x.v));
+}
+
+SIMD_TARGET_AVX2 inline float_8 log(float_8 x) {
+	return SIMD_FUNCTION_HALVES_1(log, x);
+}
+
+SIMD_TARGET_AVX2 inline float_8 log10(float_8 x) {
+	return log(x) * float(M_LOG10E);
+}
+
+SIMD_TARGET_AVX2 inline float_8 log2(float_8 x) {
+	return log(x) * float(M_LOG2E);
+}
+
+SIMD_TARGET_AVX2 inline float_8 exp(float_8 x) {
+	return SIMD_FUNCTION_HALVES_1(exp, x);
+}
+
+SIMD_TARGET_AVX2 inline float_8 exp2(float_8 x) {
+	return exp(x * float(M_LN2));
+}
+
+SIMD_TARGET_AVX2 inline float_8 sin(float_8 x) {
+	return SIMD_FUNCTION_HALVES_1(sin, x);
+}
+
+SIMD_TARGET_AVX2 inline float_8 cos(float_8 x) {
+	return SIMD_FUNCTION_HALVES_1(cos, x);
+}
+
+SIMD_TARGET_AVX2 inline void sincos(float_8 x, float_8* s, float_8* c) {
+	float_4 s1, s2, c1, c2;
+	sincos(x.lo(), &s1, &c1);
+	sincos(x.hi(), &s2, &c2);
+	*s = float_8(s1, s2);
+	*c = float_8(c1, c2);
+}
+
+SIMD_TARGET_AVX2 inline float_8 tan(float_8 x) {
+	return SIMD_FUNCTION_HALVES_1(tan, x);
+}
+
+SIMD_TARGET_AVX2 inline float_8 atan(float_8 x) {
+	return SIMD_FUNCTION_HALVES_1(atan, x);
+}
+
+SIMD_TARGET_AVX2 inline float_8 atan2(float_8 x, float_8 y) {
+	return SIMD_FUNCTION_HALVES_2(atan2, x, y);
+}
+
+SIMD_TARGET_AVX2 inline float_8 trunc(float_8 a) {
+	return float_8(_mm256_round_ps(a.v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC));
+}
+
+SIMD_TARGET_AVX2 inline float_8 floor(float_8 a) {
+	return float_8(_mm256_round_ps(a.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC));
+}
+
+SIMD_TARGET_AVX2 inline float_8 ceil(float_8 a) {
+	return float_8(_mm256_round_ps(a.v, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC));
+}
+
+SIMD_TARGET_AVX2 inline float_8 round(float_8 a) {
+	return float_8(_mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+}
+
+SIMD_TARGET_AVX2 inline float_8 fmod(float_8 a, float_8 b) {
+	return a - floor(a / b) * b;
+}
+
+SIMD_TARGET_AVX2 inline float_8 hypot(float_8 a, float_8 b) {
+	return sqrt(a * a + b * b);
+}
+
+SIMD_TARGET_AVX2 inline float_8 fabs(float_8 a) {
+	int32_8 mask = ~0x80000000;
+	return a & float_8::cast(mask);
+}
+
+SIMD_TARGET_AVX2 inline float_8 abs(float_8 a) {
+	return fabs(a);
+}
+
+SIMD_TARGET_AVX2 inline float_8 abs(std::complex<float_8> a) {
+	return hypot(a.real(), a.imag());
+}
+
+SIMD_TARGET_AVX2 inline float_8 arg(std::complex<float_8> a) {
+	return atan2(a.imag(), a.real());
+}
+
+SIMD_TARGET_AVX2 inline float_8 pow(float_8 a, float_8 b) {
+	return exp(b * log(a));
+}
+
+SIMD_TARGET_AVX2 inline float_8 pow(float a, float_8 b) {
+	return exp(b * std::log(a));
+}
+
+SIMD_TARGET_AVX2 inline float_8 clamp(float_8 x, float_8 a = 0.f, float_8 b = 1.f) {
+	return fmin(fmax(x, a), b);
+}
+
+SIMD_TARGET_AVX2 inline float_8 rescale(float_8 x, float_8 xMin, float_8 xMax, float_8 yMin, float_8 yMax) {
+	return yMin + (x - xMin) / (xMax - xMin) * (yMax - yMin);
+}
+
+SIMD_TARGET_AVX2 inline float_8 crossfade(float_8 a, float_8 b, float_8 p) {
+	return a + (b - a) * p;
+}
+
+SIMD_TARGET_AVX2 inline float_8 sgn(float_8 x) {
+	float_8 signbit = x & -0.f;
+	float_8 nonzero = (x != 0.f);
+	return signbit | (nonzero & 1.f);
+}
+
+#undef SIMD_FUNCTION_HALVES_1
+#undef SIMD_FUNCTION_HALVES_2
+#endif
+
+
 } // namespace simd
 } // namespace rack
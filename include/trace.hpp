@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+
+#include <common.hpp>
+
+
+/** Records the duration of the enclosing scope while tracing is enabled.
+`name` must be a string literal or otherwise outlive the trace.
+
+Example:
+
+	void Foo::step() {
+		TRACE_SCOPE("Foo::step");
+		...
+	}
+*/
+#define TRACE_SCOPE(name) rack::trace::Scope CONCAT(_traceScope_, __COUNTER__)(name)
+
+
+namespace rack {
+/** Records timed spans and counters from any thread and exports them as a Chrome/Perfetto trace.
+
+Each thread writes to its own fixed-size buffer without locking, overwriting its oldest events when full.
+When tracing is disabled, each span or counter costs a single relaxed atomic load.
+*/
+namespace trace {
+
+
+extern std::atomic<bool> enabled;
+
+
+inline bool isEnabled() {
+	return enabled.load(std::memory_order_relaxed);
+}
+
+/** Clears all recorded events and starts recording. */
+void start();
+/** Stops recording. Recorded events are kept until the next start(). */
+void stop();
+/** Writes recorded events in Chrome trace event JSON format, readable by Perfetto and chrome://tracing.
+Stops recording if needed.
+Throws Exception if the file cannot be written.
+*/
+void save(const std::string& path);
+
+/** Sets the name of the calling thread in the trace.
+Called by system::setThreadName().
+*/
+PRIVATE void setThreadName(const std::string& name);
+
+/** Do not call directly. Use TRACE_SCOPE(). */
+void recordSpan(const char* name, int64_t startTime, int64_t endTime);
+/** Records the value of a named counter at the current time. */
+void recordCounter(const char* name, double value);
+/** Returns the current time in nanoseconds, in the clock used by trace events. */
+int64_t getTime();
+
+
+inline void counter(const char* name, double value) {
+	if (isEnabled())
+		recordCounter(name, value);
+}
+
+
+struct Scope {
+	const char* name;
+	int64_t startTime;
+
+	Scope(const char* name) {
+		this->name = isEnabled() ? name : NULL;
+		if (this->name)
+			startTime = getTime();
+	}
+	~Scope() {
+		if (name)
+			recordSpan(name, startTime, getTime());
+	}
+};
+
+
+} // namespace trace
+} // namespace rack
@@ -23,6 +23,25 @@ struct FramebufferWidget : Widget {
 	*/
 	math::Vec viewportMargin = math::Vec(INFINITY, INFINITY);
 
+	/** Usage of framebuffers by all FramebufferWidgets */
+	struct Stats {
+		/** Number of framebuffers owned by widgets */
+		int count;
+		/** Total pixels of framebuffers owned by widgets */
+		int64_t pixels;
+		/** Number of released framebuffers kept for reuse */
+		int poolCount;
+		/** Total pixels of released framebuffers kept for reuse */
+		int64_t poolPixels;
+		/** Number of framebuffer requests served by the pool */
+		int64_t poolHits;
+		/** Number of framebuffer requests that created a new framebuffer */
+		int64_t poolMisses;
+		/** Number of framebuffers deleted to stay within `settings::framebufferBudget` */
+		int64_t evictions;
+	};
+	static Stats getStats();
+
 	FramebufferWidget();
 	~FramebufferWidget();
 	/** Requests to re-render children to the framebuffer on the next draw(). */
@@ -1,5 +1,7 @@
 #pragma once
 #include <memory>
+#include <vector>
+#include <set>
 
 #include <nanovg.h>
 #include <nanosvg.h>
@@ -50,10 +52,19 @@ struct Svg {
 	int getNumShapes();
 	int getNumPaths();
 	int getNumPoints();
+	/** Draws the SVG using geometry that is flattened and classified once per scale level and cached. */
 	void draw(NVGcontext* vg);
 
 	/** Loads Svg from a cache. */
 	static std::shared_ptr<Svg> load(const std::string& filename);
+	/** Parses SVG files in parallel and adds them to the cache, so later calls to load() return immediately.
+	Blocks until all files are loaded.
+	*/
+	static void preload(const std::vector<std::string>& filenames);
+	/** While `filenames` is not NULL, adds the filename of each load() call on the current thread to it.
+	Used to remember which SVGs a ModuleWidget loads, so they can be preloaded the next time.
+	*/
+	PRIVATE static void record(std::set<std::string>* filenames);
 };
 
 DEPRECATED typedef Svg SVG;
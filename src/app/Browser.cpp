@@ -2,10 +2,11 @@
 #include <algorithm>
 #include <thread>
 
+#include <stb_image_write.h>
+
 #include <app/Browser.hpp>
 #include <widget/OpaqueWidget.hpp>
-#include <widget/TransparentWidget.hpp>
-#include <widget/ZoomWidget.hpp>
+#include <widget/FramebufferWidget.hpp>
 #include <ui/MenuOverlay.hpp>
 #include <ui/ScrollWidget.hpp>
 #include <ui/SequentialLayout.hpp>
@@ -29,6 +30,7 @@
 #include <history.hpp>
 #include <settings.hpp>
 #include <system.hpp>
+#include <asset.hpp>
 #include <tag.hpp>
 #include <helpers.hpp>
 #include <FuzzySearchDatabase.hpp>
@@ -142,15 +144,27 @@ struct ModuleWidgetContainer : widget::Widget {
 };
 
 
+/** Returns the path of the cached preview image of a Model rendered at the given pixel scale.
+The plugin version is part of the path, so previews are re-rendered when a plugin is updated.
+*/
+static std::string getThumbnailPath(plugin::Model* model, float scale) {
+	std::string filename = string::f("%s-%g%s.png", model->slug.c_str(), scale, settings::preferDarkPanels ? "-dark" : "");
+	return system::join(asset::user("thumbnails"), model->plugin->slug, model->plugin->version, filename);
+}
+
+
 struct ModelBox : widget::OpaqueWidget {
 	plugin::Model* model;
 	ui::Tooltip* tooltip = NULL;
-	// Lazily created widgets
-	widget::Widget* previewWidget = NULL;
-	widget::ZoomWidget* zoomWidget = NULL;
-	widget::FramebufferWidget* fb = NULL;
-	ModuleWidgetContainer* mwc = NULL;
-	ModuleWidget* moduleWidget = NULL;
+	/** Size of the ModuleWidget at zoom 1, or zero before the preview is loaded */
+	math::Vec moduleSize;
+	// Lazily loaded or rendered preview image
+	std::shared_ptr<window::Image> thumbnail;
+	std::string thumbnailPath;
+	/** Size of the thumbnail image in world coordinates */
+	math::Vec thumbnailSize;
+	/** Thumbnail path whose preview failed to render, so it isn't retried every frame */
+	std::string failedPath;
 
 	ModelBox() {
 		updateZoom();
@@ -163,10 +177,8 @@ struct ModelBox : widget::OpaqueWidget {
 	void updateZoom() {
 		float zoom = std::pow(2.f, settings::browserZoom);
 
-		if (previewWidget) {
-			fb->setDirty();
-			zoomWidget->setZoom(zoom);
-			box.size.x = moduleWidget->box.size.x * zoom;
+		if (!moduleSize.isZero()) {
+			box.size.x = moduleSize.x * zoom;
 		}
 		else {
 			// Approximate size as 12HP before we know the actual size.
@@ -177,35 +189,118 @@ struct ModelBox : widget::OpaqueWidget {
 		box.size = box.size.ceil();
 	}
 
+	void setThumbnail(std::shared_ptr<window::Image> image, const std::string& path, float zoom, float pixelRatio) {
+		thumbnail = image;
+		thumbnailPath = path;
+		int width, height;
+		nvgImageSize(image->vg, image->handle, &width, &height);
+		thumbnailSize = math::Vec(width, height).div(pixelRatio);
+		if (moduleSize.isZero()) {
+			moduleSize = math::Vec(width, height).div(pixelRatio * zoom).round();
+			updateZoom();
+		}
+	}
+
+	/** Loads the preview image from the thumbnail cache, or renders it from a temporary ModuleWidget and writes it to the cache. */
 	void createPreview() {
-		if (previewWidget)
+		float zoom = std::pow(2.f, settings::browserZoom);
+		float pixelRatio = std::fmax(1.f, std::floor(APP->window->pixelRatio));
+		std::string path = getThumbnailPath(model, zoom * pixelRatio);
+		if (thumbnail && path == thumbnailPath)
+			return;
+		if (path == failedPath)
 			return;
 
-		previewWidget = new widget::TransparentWidget;
-		addChild(previewWidget);
+		// Load or render only if there is frame time remaining, or if it's one of the first framebuffers this frame, like FramebufferWidget.
+		const int minCount = 1;
+		const double minRemaining = -1 / 60.0;
+		int count = ++APP->window->fbCount();
+		double remaining = APP->window->getFrameDurationRemaining();
+		if (!(count <= minCount || remaining > minRemaining))
+			return;
 
-		zoomWidget = new widget::ZoomWidget;
-		previewWidget->addChild(zoomWidget);
+		if (system::isFile(path)) {
+			try {
+				std::shared_ptr<window::Image> image = std::make_shared<window::Image>();
+				image->loadFile(path, APP->window->vg);
+				setThumbnail(image, path, zoom, pixelRatio);
+				return;
+			}
+			catch (Exception& e) {
+				WARN("%s", e.what());
+			}
+		}
 
-		fb = new widget::FramebufferWidget;
+		widget::FramebufferWidget* fb = new widget::FramebufferWidget;
+		DEFER({delete fb;});
 		if (APP->window->pixelRatio < 2.0) {
 			// Small details draw poorly at low DPI, so oversample when drawing to the framebuffer
 			fb->oversample = 2.0;
 		}
-		zoomWidget->addChild(fb);
 
-		mwc = new ModuleWidgetContainer;
+		ModuleWidgetContainer* mwc = new ModuleWidgetContainer;
 		fb->addChild(mwc);
 
 		INFO("Creating module widget %s", model->getFullName().c_str());
-		moduleWidget = model->createModuleWidget(NULL);
+		ModuleWidget* moduleWidget = model->createModuleWidget(NULL);
 		mwc->addChild(moduleWidget);
 		mwc->box.size = moduleWidget->box.size;
+		fb->box.size = moduleWidget->box.size;
+		moduleSize = moduleWidget->box.size;
+		updateZoom();
 
 		// Step ModuleWidget so it can set its default appearance.
-		moduleWidget->step();
+		fb->step();
+		fb->render(math::Vec(zoom, zoom));
+		if (!fb->getFramebuffer()) {
+			failedPath = path;
+			return;
+		}
 
-		updateZoom();
+		// Read pixels, flipping rows since OpenGL's origin is the bottom-left corner
+		math::Vec fbSize = fb->getFramebufferSize();
+		int width = fbSize.x;
+		int height = fbSize.y;
+		std::vector<uint8_t> pixels(height * width * 4);
+		nvgluBindFramebuffer(fb->getFramebuffer());
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		nvgluBindFramebuffer(NULL);
+		for (int y = 0; y < height / 2; y++) {
+			std::swap_ranges(&pixels[y * width * 4], &pixels[(y + 1) * width * 4], &pixels[(height - 1 - y) * width * 4]);
+		}
+
+		// The framebuffer has premultiplied alpha
+		std::shared_ptr<window::Image> image = std::make_shared<window::Image>();
+		image->vg = APP->window->vg;
+		image->handle = nvgCreateImageRGBA(image->vg, width, height, NVG_IMAGE_PREMULTIPLIED, pixels.data());
+		if (image->handle <= 0) {
+			failedPath = path;
+			return;
+		}
+		setThumbnail(image, path, zoom, pixelRatio);
+
+		// Encode PNG in a worker thread, writing to a temporary file first so an interrupted write isn't mistaken for a valid thumbnail.
+		std::thread t([=]() mutable {
+			// PNG has straight alpha, which is also what Image::loadFile() expects.
+			for (int i = 0; i < width * height * 4; i += 4) {
+				int a = pixels[i + 3];
+				if (a == 0 || a == 255)
+					continue;
+				for (int c = 0; c < 3; c++) {
+					pixels[i + c] = std::min((pixels[i + c] * 255 + a / 2) / a, 255);
+				}
+			}
+
+			system::createDirectories(system::getDirectory(path));
+			std::string tmpPath = path + ".tmp";
+			if (!stbi_write_png(tmpPath.c_str(), width, height, 4, pixels.data(), width * 4)) {
+				WARN("Could not write module thumbnail %s", path.c_str());
+				return;
+			}
+			system::remove(path);
+			system::rename(tmpPath, path);
+		});
+		t.detach();
 	}
 
 	void draw(const DrawArgs& args) override {
@@ -226,6 +321,13 @@ struct ModelBox : widget::OpaqueWidget {
 		float b = math::clamp(settings::rackBrightness + 0.2f, 0.f, 1.f);
 		nvgGlobalTint(args.vg, nvgRGBAf(b, b, b, 1));
 
+		if (thumbnail) {
+			nvgBeginPath(args.vg);
+			nvgRect(args.vg, 0, 0, thumbnailSize.x, thumbnailSize.y);
+			nvgFillPaint(args.vg, nvgImagePattern(args.vg, 0, 0, thumbnailSize.x, thumbnailSize.y, 0.0, thumbnail->handle, 1.0));
+			nvgFill(args.vg);
+		}
+
 		OpaqueWidget::draw(args);
 
 		// Draw favorite border
@@ -324,6 +426,12 @@ struct ModelBox : widget::OpaqueWidget {
 		setTooltip(NULL);
 	}
 
+	void onContextDestroy(const ContextDestroyEvent& e) override {
+		// The thumbnail image belongs to the NanoVG context
+		thumbnail = NULL;
+		OpaqueWidget::onContextDestroy(e);
+	}
+
 	void onHide(const HideEvent& e) override {
 		// Hide tooltip
 		setTooltip(NULL);
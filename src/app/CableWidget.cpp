@@ -117,6 +117,18 @@ struct PlugWidget : widget::Widget {
 
 
 struct CableWidget::Internal {
+	/** Whether the cached geometry has been computed */
+	bool geometryValid = false;
+	/** Inputs of the cached geometry. When these change, the geometry is recomputed. */
+	math::Vec outputPos;
+	math::Vec inputPos;
+	float cableTension = NAN;
+	/** Cached geometry */
+	math::Vec slump;
+	math::Vec outputEnd;
+	math::Vec inputEnd;
+	/** Bounding box of the cable and its shadow, including stroke width */
+	math::Rect bounds;
 };
 
 
@@ -249,10 +261,37 @@ static math::Vec getSlumpPos(math::Vec pos1, math::Vec pos2) {
 }
 
 
+/** Recomputes the cable curve if its endpoints or tension have changed since it was last computed. */
+static void updateGeometry(CableWidget::Internal* internal, math::Vec outputPos, math::Vec inputPos) {
+	if (internal->geometryValid && outputPos.equals(internal->outputPos) && inputPos.equals(internal->inputPos) && settings::cableTension == internal->cableTension)
+		return;
+
+	internal->geometryValid = true;
+	internal->outputPos = outputPos;
+	internal->inputPos = inputPos;
+	internal->cableTension = settings::cableTension;
+
+	math::Vec slump = getSlumpPos(outputPos, inputPos);
+	internal->slump = slump;
+	// The endpoints are off-center
+	internal->outputEnd = outputPos.plus(slump.minus(outputPos).normalize().mult(13.0));
+	internal->inputEnd = inputPos.plus(slump.minus(inputPos).normalize().mult(13.0));
+
+	// A quadratic Bezier curve is contained in the convex hull of its control points.
+	math::Vec shadowSlump = slump.plus(math::Vec(0, 30));
+	math::Vec min = internal->outputEnd.min(internal->inputEnd).min(slump).min(shadowSlump);
+	math::Vec max = internal->outputEnd.max(internal->inputEnd).max(slump).max(shadowSlump);
+	// Half the thickest stroke width, rounded up
+	const float strokeRadius = 5.f;
+	internal->bounds = math::Rect::fromMinMax(min, max).grow(math::Vec(strokeRadius, strokeRadius));
+}
+
+
 void CableWidget::step() {
 	math::Vec outputPos = getOutputPos();
 	math::Vec inputPos = getInputPos();
-	math::Vec slump = getSlumpPos(outputPos, inputPos);
+	updateGeometry(internal, outputPos, inputPos);
+	math::Vec slump = internal->slump;
 
 	NVGcolor colorOpaque = color;
 	colorOpaque.a = 1.f;
@@ -286,6 +325,16 @@ void CableWidget::draw(const DrawArgs& args) {
 void CableWidget::drawLayer(const DrawArgs& args, int layer) {
 	// Cable shadow and cable
 	if (layer == 2 || layer == 3) {
+		// step() normally computes the geometry, but the cable might not have been stepped yet.
+		if (!internal->geometryValid)
+			updateGeometry(internal, getOutputPos(), getInputPos());
+
+		// Skip cables outside the viewport
+		if (!args.clipBox.intersects(internal->bounds)) {
+			Widget::drawLayer(args, layer);
+			return;
+		}
+
 		float opacity = settings::cableOpacity;
 		bool thick = false;
 
@@ -315,15 +364,11 @@ void CableWidget::drawLayer(const DrawArgs& args, int layer) {
 			return;
 		nvgAlpha(args.vg, std::pow(opacity, 1.5));
 
-		math::Vec outputPos = getOutputPos();
-		math::Vec inputPos = getInputPos();
-
 		float thickness = thick ? 9.0 : 6.0;
 
-		// The endpoints are off-center
-		math::Vec slump = getSlumpPos(outputPos, inputPos);
-		outputPos = outputPos.plus(slump.minus(outputPos).normalize().mult(13.0));
-		inputPos = inputPos.plus(slump.minus(inputPos).normalize().mult(13.0));
+		math::Vec slump = internal->slump;
+		math::Vec outputPos = internal->outputEnd;
+		math::Vec inputPos = internal->inputEnd;
 
 		nvgLineCap(args.vg, NVG_ROUND);
 		// Avoids glitches when cable is bent
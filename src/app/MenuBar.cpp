@@ -24,6 +24,7 @@
 #include <plugin.hpp>
 #include <patch.hpp>
 #include <library.hpp>
+#include <trace.hpp>
 
 
 namespace rack {
@@ -419,6 +420,29 @@ struct ViewButton : MenuButton {
 			}
 		}));
 
+		static const std::vector<float> throttledFrameRates = {0.f, 30.f, 15.f, 10.f, 5.f, 1.f};
+		auto getThrottledFrameRateText = [](float frameRate) -> std::string {
+			return (frameRate > 0) ? string::f("%.0f Hz", frameRate) : "Off";
+		};
+
+		menu->addChild(createSubmenuItem("Frame rate when idle", getThrottledFrameRateText(settings::idleFrameRateLimit), [=](ui::Menu* menu) {
+			for (float frameRate : throttledFrameRates) {
+				menu->addChild(createCheckMenuItem(getThrottledFrameRateText(frameRate), "",
+					[=]() {return settings::idleFrameRateLimit == frameRate;},
+					[=]() {settings::idleFrameRateLimit = frameRate;}
+				));
+			}
+		}));
+
+		menu->addChild(createSubmenuItem("Frame rate when unfocused", getThrottledFrameRateText(settings::backgroundFrameRateLimit), [=](ui::Menu* menu) {
+			for (float frameRate : throttledFrameRates) {
+				menu->addChild(createCheckMenuItem(getThrottledFrameRateText(frameRate), "",
+					[=]() {return settings::backgroundFrameRateLimit == frameRate;},
+					[=]() {settings::backgroundFrameRateLimit = frameRate;}
+				));
+			}
+		}));
+
 		menu->addChild(new ui::MenuSeparator);
 		menu->addChild(createMenuLabel("Appearance"));
 
@@ -890,6 +914,25 @@ struct HelpButton : MenuButton {
 			system::openBrowser("https://github.com/VCVRack/Rack/blob/v2/CHANGELOG.md");
 		}));
 
+		if (!trace::isEnabled()) {
+			menu->addChild(createMenuItem("Record performance trace", "", [=]() {
+				trace::start();
+			}));
+		}
+		else {
+			menu->addChild(createMenuItem("Save performance trace", "", [=]() {
+				std::string tracePath = asset::user("trace.json");
+				try {
+					trace::save(tracePath);
+					INFO("Saved trace to %s", tracePath.c_str());
+					system::openDirectory(asset::user(""));
+				}
+				catch (Exception& e) {
+					WARN("%s", e.what());
+				}
+			}));
+		}
+
 		if (library::isAppUpdateAvailable()) {
 			menu->addChild(createMenuItem("Update " + APP_NAME, APP_VERSION + " → " + library::appVersion, [=]() {
 				system::openBrowser(library::appDownloadUrl);
@@ -1,4 +1,5 @@
 #include <map>
+#include <set>
 #include <algorithm>
 #include <queue>
 #include <functional>
@@ -16,6 +17,7 @@
 #include <system.hpp>
 #include <asset.hpp>
 #include <patch.hpp>
+#include <window/Svg.hpp>
 #include <helpers.hpp>
 
 
@@ -37,6 +39,48 @@ struct RackWidget::Internal {
 	math::Vec selectionEnd;
 	std::set<ModuleWidget*> selectedModules;
 	std::map<widget::Widget*, math::Vec> moduleOldPositions;
+
+	/** ModuleWidgets by module ID */
+	std::map<int64_t, ModuleWidget*> moduleIds;
+	/** Complete cables by cable ID */
+	std::map<int64_t, CableWidget*> cableIds;
+	/** Complete cables attached to each port, from the bottom to the top of the stack */
+	std::map<PortWidget*, std::vector<CableWidget*>> portCables;
+};
+
+
+/** Boxes of modules grouped by row, for checking collisions in O(log n) time instead of O(n).
+
+Callers build a new index for each placement instead of maintaining one alongside `moduleIds`.
+Each placement excludes different modules (the one being moved, or the selection), and ModuleWidget positions are changed in many places that don't go through RackWidget, so an incremental index could go stale.
+Building it is O(n log n) once per call, while the search it speeds up can try many positions with O(n) checks each.
+*/
+struct ModuleRowIndex {
+	/** Top of row -> (left -> right) of module boxes */
+	std::map<float, std::map<float, float>> rows;
+
+	void add(math::Rect box) {
+		rows[box.getTop()][box.getLeft()] = box.getRight();
+	}
+
+	/** Returns whether the box might be free of collisions.
+	May return true for colliding boxes, e.g. if the added boxes overlap each other, but never returns false for free ones.
+	Callers must still check positions for which this returns true exactly.
+	*/
+	bool isFree(math::Rect box) const {
+		// Iterate rows that overlap the box vertically. All modules are RACK_GRID_HEIGHT tall.
+		for (auto rowIt = rows.upper_bound(box.getTop() - RACK_GRID_HEIGHT); rowIt != rows.end() && rowIt->first < box.getBottom(); rowIt++) {
+			const std::map<float, float>& row = rowIt->second;
+			// The last module starting left of the box's right edge is the only one that can overlap it.
+			auto it = row.lower_bound(box.getRight());
+			if (it == row.begin())
+				continue;
+			it--;
+			if (it->second > box.getLeft())
+				return false;
+		}
+		return true;
+	}
 };
 
 
@@ -325,7 +369,15 @@ void RackWidget::fromJson(json_t* rootJ) {
 
 		// Create ModuleWidget
 		INFO("Creating module widget %s", module->model->getFullName().c_str());
-		ModuleWidget* mw = module->model->createModuleWidget(module);
+		// Record the SVGs the ModuleWidget loads, so the next patch using this Model can preload them.
+		std::set<std::string> svgFilenames;
+		ModuleWidget* mw;
+		{
+			window::Svg::record(&svgFilenames);
+			DEFER({window::Svg::record(NULL);});
+			mw = module->model->createModuleWidget(module);
+		}
+		APP->patch->setModelSvgs(module->model, svgFilenames);
 
 		// pos
 		json_t* posJ = json_object_get(moduleJ, "pos");
@@ -342,6 +394,7 @@ void RackWidget::fromJson(json_t* rootJ) {
 		setModulePosForce(mw, pos);
 
 		internal->moduleContainer->addChild(mw);
+		internal->moduleIds[mw->module->id] = mw;
 	}
 
 	updateExpanders();
@@ -438,6 +491,7 @@ static PasteJsonResult RackWidget_pasteJson(RackWidget* that, json_t* rootJ, his
 		maxPos = maxPos.max(mw->box.getBottomRight());
 
 		that->internal->moduleContainer->addChild(mw);
+		that->internal->moduleIds[mw->module->id] = mw;
 		that->select(mw);
 
 		newModules[id] = mw;
@@ -602,6 +656,7 @@ void RackWidget::addModule(ModuleWidget* m) {
 		throw Exception("Module %s height is %g px, must be %g px", m->model->getFullName().c_str(), m->box.size.y, RACK_GRID_HEIGHT);
 
 	internal->moduleContainer->addChild(m);
+	internal->moduleIds[m->module->id] = m;
 
 	updateExpanders();
 }
@@ -635,18 +690,16 @@ void RackWidget::removeModule(ModuleWidget* m) {
 
 	// Remove module from ModuleContainer
 	internal->moduleContainer->removeChild(m);
+	internal->moduleIds.erase(m->module->id);
 
 	updateExpanders();
 }
 
 ModuleWidget* RackWidget::getModule(int64_t moduleId) {
-	for (widget::Widget* w : internal->moduleContainer->children) {
-		ModuleWidget* mw = dynamic_cast<ModuleWidget*>(w);
-		assert(mw);
-		if (mw->module->id == moduleId)
-			return mw;
-	}
-	return NULL;
+	auto it = internal->moduleIds.find(moduleId);
+	if (it == internal->moduleIds.end())
+		return NULL;
+	return it->second;
 }
 
 std::vector<ModuleWidget*> RackWidget::getModules() {
@@ -703,7 +756,16 @@ static math::Vec eachNearestGridPos(math::Vec pos, std::function<bool(math::Vec
 }
 
 void RackWidget::setModulePosNearest(ModuleWidget* mw, math::Vec pos) {
+	ModuleRowIndex index;
+	for (widget::Widget* w2 : internal->moduleContainer->children) {
+		if (w2 != mw)
+			index.add(w2->box);
+	}
+
 	eachNearestGridPos(pos, [&](math::Vec pos) -> bool {
+		// Skip positions known to collide without scanning all modules
+		if (!index.isFree(math::Rect(pos, mw->box.size)))
+			return false;
 		return requestModulePos(mw, pos);
 	});
 }
@@ -1294,7 +1356,18 @@ bool RackWidget::requestSelectionPos(math::Vec delta) {
 }
 
 void RackWidget::setSelectionPosNearest(math::Vec delta) {
+	ModuleRowIndex index;
+	for (widget::Widget* w2 : internal->moduleContainer->children) {
+		if (!isSelected(static_cast<ModuleWidget*>(w2)))
+			index.add(w2->box);
+	}
+
 	eachNearestGridPos(delta, [&](math::Vec delta) -> bool {
+		// Skip positions known to collide without scanning all modules
+		for (ModuleWidget* mw : getSelected()) {
+			if (!index.isFree(math::Rect(mw->box.pos + delta, mw->box.size)))
+				return false;
+		}
 		return requestSelectionPos(delta);
 	});
 }
@@ -1373,6 +1446,8 @@ void RackWidget::appendSelectionContextMenu(ui::Menu* menu) {
 void RackWidget::clearCables() {
 	internal->incompleteCable = NULL;
 	internal->cableContainer->clearChildren();
+	internal->cableIds.clear();
+	internal->portCables.clear();
 }
 
 void RackWidget::clearCablesAction() {
@@ -1412,11 +1487,31 @@ void RackWidget::clearCablesOnPort(PortWidget* port) {
 void RackWidget::addCable(CableWidget* cw) {
 	assert(cw->isComplete());
 	internal->cableContainer->addChild(cw);
+
+	if (cw->cable)
+		internal->cableIds[cw->cable->id] = cw;
+	internal->portCables[cw->inputPort].push_back(cw);
+	internal->portCables[cw->outputPort].push_back(cw);
+}
+
+static void removePortCable(RackWidget::Internal* internal, PortWidget* port, CableWidget* cw) {
+	auto it = internal->portCables.find(port);
+	if (it == internal->portCables.end())
+		return;
+	std::vector<CableWidget*>& cws = it->second;
+	cws.erase(std::remove(cws.begin(), cws.end(), cw), cws.end());
+	if (cws.empty())
+		internal->portCables.erase(it);
 }
 
 void RackWidget::removeCable(CableWidget* cw) {
 	assert(cw->isComplete());
 	internal->cableContainer->removeChild(cw);
+
+	if (cw->cable)
+		internal->cableIds.erase(cw->cable->id);
+	removePortCable(internal, cw->inputPort, cw);
+	removePortCable(internal, cw->outputPort, cw);
 }
 
 CableWidget* RackWidget::getIncompleteCable() {
@@ -1445,26 +1540,28 @@ CableWidget* RackWidget::releaseIncompleteCable() {
 	return cw;
 }
 
+/** Returns whether the incomplete cable is attached to the port. */
+static bool isIncompleteCableOnPort(RackWidget::Internal* internal, PortWidget* port) {
+	CableWidget* cw = internal->incompleteCable;
+	return cw && (cw->inputPort == port || cw->outputPort == port);
+}
+
 CableWidget* RackWidget::getTopCable(PortWidget* port) {
-	for (auto it = internal->cableContainer->children.rbegin(); it != internal->cableContainer->children.rend(); it++) {
-		CableWidget* cw = dynamic_cast<CableWidget*>(*it);
-		assert(cw);
-		if (cw->inputPort == port || cw->outputPort == port)
-			return cw;
-	}
-	return NULL;
+	// The incomplete cable is always added after complete cables, so it's on top.
+	if (isIncompleteCableOnPort(internal, port))
+		return internal->incompleteCable;
+
+	auto it = internal->portCables.find(port);
+	if (it == internal->portCables.end())
+		return NULL;
+	return it->second.back();
 }
 
 CableWidget* RackWidget::getCable(int64_t cableId) {
-	for (widget::Widget* w : internal->cableContainer->children) {
-		CableWidget* cw = dynamic_cast<CableWidget*>(w);
-		assert(cw);
-		if (!cw->cable)
-			continue;
-		if (cw->cable->id == cableId)
-			return cw;
-	}
-	return NULL;
+	auto it = internal->cableIds.find(cableId);
+	if (it == internal->cableIds.end())
+		return NULL;
+	return it->second;
 }
 
 std::vector<CableWidget*> RackWidget::getCompleteCables() {
@@ -1482,30 +1579,18 @@ std::vector<CableWidget*> RackWidget::getCompleteCables() {
 
 std::vector<CableWidget*> RackWidget::getCablesOnPort(PortWidget* port) {
 	assert(port);
-	std::vector<CableWidget*> cws;
-	for (widget::Widget* w : internal->cableContainer->children) {
-		CableWidget* cw = dynamic_cast<CableWidget*>(w);
-		assert(cw);
-		if (cw->inputPort == port || cw->outputPort == port) {
-			cws.push_back(cw);
-		}
-	}
+	std::vector<CableWidget*> cws = getCompleteCablesOnPort(port);
+	if (isIncompleteCableOnPort(internal, port))
+		cws.push_back(internal->incompleteCable);
 	return cws;
 }
 
 std::vector<CableWidget*> RackWidget::getCompleteCablesOnPort(PortWidget* port) {
 	assert(port);
-	std::vector<CableWidget*> cws;
-	for (widget::Widget* w : internal->cableContainer->children) {
-		CableWidget* cw = dynamic_cast<CableWidget*>(w);
-		assert(cw);
-		if (!cw->isComplete())
-			continue;
-		if (cw->inputPort == port || cw->outputPort == port) {
-			cws.push_back(cw);
-		}
-	}
-	return cws;
+	auto it = internal->portCables.find(port);
+	if (it == internal->portCables.end())
+		return {};
+	return it->second;
 }
 
 
@@ -1543,31 +1628,31 @@ void RackWidget::setTouchedParam(ParamWidget* pw) {
 
 
 void RackWidget::updateExpanders() {
+	// Index modules by the grid positions of their top-left and top-right corners.
+	// If multiple modules share a corner, the last one wins.
+	std::map<std::pair<float, float>, ModuleWidget*> leftCorners;
+	std::map<std::pair<float, float>, ModuleWidget*> rightCorners;
 	for (widget::Widget* w : internal->moduleContainer->children) {
 		ModuleWidget* mw = (ModuleWidget*) w;
+		math::Rect gridBox = mw->getGridBox();
+		leftCorners[std::make_pair(gridBox.getTop(), gridBox.getLeft())] = mw;
+		rightCorners[std::make_pair(gridBox.getTop(), gridBox.getRight())] = mw;
+	}
 
-		math::Vec pLeft = mw->getGridBox().getTopLeft();
-		math::Vec pRight = mw->getGridBox().getTopRight();
-		ModuleWidget* mwLeft = NULL;
-		ModuleWidget* mwRight = NULL;
+	for (widget::Widget* w : internal->moduleContainer->children) {
+		ModuleWidget* mw = (ModuleWidget*) w;
+		math::Rect gridBox = mw->getGridBox();
 
 		// Find adjacent modules
-		for (widget::Widget* w2 : internal->moduleContainer->children) {
-			ModuleWidget* mw2 = (ModuleWidget*) w2;
-			if (mw2 == mw)
-				continue;
-
-			math::Vec p2Left = mw2->getGridBox().getTopLeft();
-			math::Vec p2Right = mw2->getGridBox().getTopRight();
-
-			// Check if this is a left module
-			if (p2Right.equals(pLeft))
-				mwLeft = mw2;
+		ModuleWidget* mwLeft = NULL;
+		auto leftIt = rightCorners.find(std::make_pair(gridBox.getTop(), gridBox.getLeft()));
+		if (leftIt != rightCorners.end() && leftIt->second != mw)
+			mwLeft = leftIt->second;
 
-			// Check if this is a right module
-			if (p2Left.equals(pRight))
-				mwRight = mw2;
-		}
+		ModuleWidget* mwRight = NULL;
+		auto rightIt = leftCorners.find(std::make_pair(gridBox.getTop(), gridBox.getRight()));
+		if (rightIt != leftCorners.end() && rightIt->second != mw)
+			mwRight = rightIt->second;
 
 		mw->module->leftExpander.moduleId = mwLeft ? mwLeft->module->id : -1;
 		mw->module->rightExpander.moduleId = mwRight ? mwRight->module->id : -1;
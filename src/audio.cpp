@@ -1,6 +1,7 @@
 #include <audio.hpp>
 #include <string.hpp>
 #include <math.hpp>
+#include <rcu.hpp>
 
 
 namespace rack {
@@ -9,6 +10,12 @@ namespace audio {
 
 static std::vector<std::pair<int, Driver*>> drivers;
 
+/** Copy of each Device's `subscribed` set that driver threads iterate without locking.
+Kept outside of Device so its layout stays compatible with plugins compiled against earlier headers.
+unsubscribe() waits until processBuffer() no longer uses the Port, so the Port can be destroyed afterward.
+*/
+static RcuListMap<const Device*, Port*> devicePorts;
+
 ////////////////////
 // Driver
 ////////////////////
@@ -21,6 +28,7 @@ static std::vector<std::pair<int, Driver*>> drivers;
 void Device::subscribe(Port* port) {
 	std::lock_guard<std::mutex> lock(processMutex);
 	subscribed.insert(port);
+	devicePorts.set(this, std::vector<Port*>(subscribed.begin(), subscribed.end()));
 }
 
 void Device::unsubscribe(Port* port) {
@@ -28,37 +36,41 @@ void Device::unsubscribe(Port* port) {
 	auto it = subscribed.find(port);
 	if (it != subscribed.end())
 		subscribed.erase(it);
+	devicePorts.set(this, std::vector<Port*>(subscribed.begin(), subscribed.end()));
 }
 
 void Device::processBuffer(const float* input, int inputStride, float* output, int outputStride, int frames) {
 	// Zero output since Ports might not write to all elements, or no Ports exist
 	std::fill_n(output, frames * outputStride, 0.f);
 
-	std::lock_guard<std::mutex> lock(processMutex);
-	for (Port* port : subscribed) {
+	// Don't lock, since this is called by the real-time driver thread.
+	RcuListMap<const Device*, Port*>::Reader ports(devicePorts, this);
+	for (Port* port : ports) {
 		// Setting the thread context should probably be the responsibility of Port, but because processInput() etc are overridden, this is the only good place for it.
 		contextSet(port->context);
 		port->processInput(input + port->inputOffset, inputStride, frames);
 	}
-	for (Port* port : subscribed) {
+	for (Port* port : ports) {
 		contextSet(port->context);
 		port->processBuffer(input + port->inputOffset, inputStride, output + port->outputOffset, outputStride, frames);
 	}
-	for (Port* port : subscribed) {
+	for (Port* port : ports) {
 		contextSet(port->context);
 		port->processOutput(output + port->outputOffset, outputStride, frames);
 	}
 }
 
 void Device::onStartStream() {
-	for (Port* port : subscribed) {
+	RcuListMap<const Device*, Port*>::Reader ports(devicePorts, this);
+	for (Port* port : ports) {
 		contextSet(port->context);
 		port->onStartStream();
 	}
 }
 
 void Device::onStopStream() {
-	for (Port* port : subscribed) {
+	RcuListMap<const Device*, Port*>::Reader ports(devicePorts, this);
+	for (Port* port : ports) {
 		contextSet(port->context);
 		port->onStopStream();
 	}
@@ -0,0 +1,830 @@
+#include <algorithm>
+#include <vector>
+#include <thread>
+#include <random>
+
+#include <bench.hpp>
+#include <system.hpp>
+#include <string.hpp>
+#include <random.hpp>
+#include <settings.hpp>
+#include <mutex.hpp>
+#include <rcu.hpp>
+#include <midi.hpp>
+#include <math.hpp>
+#include <simd/functions.hpp>
+#include <dsp/approx.hpp>
+#include <dsp/filter.hpp>
+#include <dsp/digital.hpp>
+#include <dsp/vumeter.hpp>
+#include <dsp/resampler.hpp>
+#include <dsp/minblep.hpp>
+#include <dsp/fft.hpp>
+#include <dsp/fir.hpp>
+#include <dsp/ode.hpp>
+#include <engine/Engine.hpp>
+#include <engine/Module.hpp>
+#include <engine/Cable.hpp>
+
+
+namespace rack {
+namespace bench {
+
+
+using simd::float_4;
+
+
+/** Number of random input samples. Inputs are read cyclically so the compiler can't fold them into constants. */
+static const int INPUT_LEN = 1 << 12;
+static const int INPUT_MASK = INPUT_LEN - 1;
+
+
+Result measure(const std::string& name, Function f, double repetitionTime, int repetitions) {
+	Result result;
+	result.name = name;
+	result.repetitions = repetitions;
+
+	auto time = [&](int64_t iterations) {
+		double startTime = system::getTime();
+		f(iterations);
+		return system::getTime() - startTime;
+	};
+
+	// Double the number of iterations until a run takes long enough to time accurately, which also warms up caches and branch predictors.
+	int64_t iterations = 1;
+	double duration;
+	while ((duration = time(iterations)) < repetitionTime / 5) {
+		iterations *= 2;
+	}
+	iterations = std::max<int64_t>(1, iterations * repetitionTime / duration);
+	result.iterations = iterations;
+
+	std::vector<double> ns;
+	for (int i = 0; i < repetitions; i++) {
+		ns.push_back(time(iterations) * 1e9 / iterations);
+	}
+	std::sort(ns.begin(), ns.end());
+	result.nsMedian = ns[ns.size() / 2];
+	result.nsMin = ns[0];
+	return result;
+}
+
+
+/** Defines a function object that can be called with float or float_4. */
+#define MATH_FUNCTION(Name, expr) \
+	struct Name { \
+		template <typename T> \
+		T operator()(T x) {return expr;} \
+	}
+
+MATH_FUNCTION(Sin, simd::sin(x));
+MATH_FUNCTION(Exp, simd::exp(x));
+MATH_FUNCTION(Exp2, simd::exp2(x));
+MATH_FUNCTION(Log, simd::log(simd::fabs(x) + 1.f));
+MATH_FUNCTION(Exp2Taylor5, dsp::exp2_taylor5(x));
+MATH_FUNCTION(Log2Taylor5, dsp::log2_taylor5(simd::fabs(x) + 1.f));
+MATH_FUNCTION(TanhTaylor5, dsp::tanh_taylor5(x));
+MATH_FUNCTION(TanhPade, dsp::tanh_pade(x));
+MATH_FUNCTION(TanPade, dsp::tan_pade(x));
+
+struct Sincos {
+	template <typename T>
+	T operator()(T x) {
+		T s, c;
+		simd::sincos(x, &s, &c);
+		return s + c;
+	}
+};
+
+
+struct Runner {
+	std::string filter;
+	alignas(32) float input[INPUT_LEN];
+
+	Runner(const std::string& filter) {
+		this->filter = filter;
+		for (int i = 0; i < INPUT_LEN; i++) {
+			input[i] = random::normal();
+		}
+	}
+
+	bool matches(const std::string& name) {
+		return name.find(filter) != std::string::npos;
+	}
+
+	void bench(const std::string& name, Function f) {
+		if (!matches(name))
+			return;
+		Result r = measure(name, f);
+		std::printf("{\"name\": \"%s\", \"iterations\": %lld, \"repetitions\": %d, \"nsMedian\": %.4g, \"nsMin\": %.4g}\n", r.name.c_str(), (long long) r.iterations, r.repetitions, r.nsMedian, r.nsMin);
+		std::fflush(stdout);
+	}
+
+	float in(int64_t i) {
+		return input[i & INPUT_MASK];
+	}
+
+	float_4 in4(int64_t i) {
+		return float_4::load(&input[(i * 4) & INPUT_MASK]);
+	}
+
+	/** Benchmarks a function of one float, scalar and 4-wide. */
+	template <typename F>
+	void benchMath(const std::string& name, F f) {
+		bench(name + ".float", [&](int64_t n) {
+			float y = 0.f;
+			for (int64_t i = 0; i < n; i++) {
+				y += f(in(i));
+			}
+			use(y);
+		});
+		bench(name + ".float_4", [&](int64_t n) {
+			float_4 y = 0.f;
+			for (int64_t i = 0; i < n; i++) {
+				y += f(in4(i));
+			}
+			use(y);
+		});
+	}
+
+	void runMath() {
+		benchMath("simd.sin", Sin());
+		benchMath("simd.exp", Exp());
+		benchMath("simd.exp2", Exp2());
+		benchMath("simd.log", Log());
+		benchMath("simd.sincos", Sincos());
+		benchMath("dsp.exp2_taylor5", Exp2Taylor5());
+		benchMath("dsp.log2_taylor5", Log2Taylor5());
+		benchMath("dsp.tanh_taylor5", TanhTaylor5());
+		benchMath("dsp.tanh_pade", TanhPade());
+		benchMath("dsp.tan_pade", TanPade());
+	}
+
+	void runRandom() {
+		bench("random.uniform", [&](int64_t n) {
+			float y = 0.f;
+			for (int64_t i = 0; i < n; i++) {
+				y += random::uniform();
+			}
+			use(y);
+		});
+		bench("random.normal", [&](int64_t n) {
+			float y = 0.f;
+			for (int64_t i = 0; i < n; i++) {
+				y += random::normal();
+			}
+			use(y);
+		});
+		random::Xoshiro128Plus_4 rng;
+		rng.seed();
+		bench("random.Xoshiro128Plus_4.uniform", [&](int64_t n) {
+			float_4 y = 0.f;
+			for (int64_t i = 0; i < n; i++) {
+				y += rng.uniform();
+			}
+			use(y);
+		});
+		bench("random.Xoshiro128Plus_4.normal", [&](int64_t n) {
+			float_4 y = 0.f;
+			for (int64_t i = 0; i < n; i++) {
+				y += rng.normal();
+			}
+			use(y);
+		});
+	}
+
+	void runFilters() {
+		const float deltaTime = 1 / 48000.f;
+
+		dsp::RCFilter rc;
+		rc.setCutoffFreq(0.01f);
+		bench("dsp.RCFilter", [&](int64_t n) {
+			for (int64_t i = 0; i < n; i++) {
+				rc.process(in(i));
+			}
+			use(rc);
+		});
+
+		dsp::TExponentialFilter<float_4> exponential;
+		exponential.setTau(0.01f);
+		bench("dsp.ExponentialFilter.float_4", [&](int64_t n) {
+			float_4 y = 0.f;
+			for (int64_t i = 0; i < n; i++) {
+				y += exponential.process(deltaTime, in4(i));
+			}
+			use(y);
+		});
+
+		dsp::TSlewLimiter<float_4> slew;
+		slew.setRiseFall(1000.f, 1000.f);
+		bench("dsp.SlewLimiter.float_4", [&](int64_t n) {
+			float_4 y = 0.f;
+			for (int64_t i = 0; i < n; i++) {
+				y += slew.process(deltaTime, in4(i));
+			}
+			use(y);
+		});
+
+		dsp::BiquadFilter biquad;
+		biquad.setParameters(dsp::BiquadFilter::LOWPASS, 0.01f, 0.707f, 1.f);
+		bench("dsp.BiquadFilter", [&](int64_t n) {
+			float y = 0.f;
+			for (int64_t i = 0; i < n; i++) {
+				y += biquad.process(in(i));
+			}
+			use(y);
+		});
+
+		dsp::TBiquadCascade<4, float_4> cascade;
+		for (int stage = 0; stage < 4; stage++) {
+			cascade.setParameters(stage, dsp::TBiquadFilter<float_4>::LOWPASS, 0.01f, 0.707f, 1.f);
+		}
+		bench("dsp.BiquadCascade.4.float_4", [&](int64_t n) {
+			float_4 y = 0.f;
+			for (int64_t i = 0; i < n; i++) {
+				y += cascade.process(in4(i));
+			}
+			use(y);
+		});
+
+		dsp::VuMeter2 vuMeter;
+		bench("dsp.VuMeter2", [&](int64_t n) {
+			for (int64_t i = 0; i < n; i++) {
+				vuMeter.process(deltaTime, in(i));
+			}
+			use(vuMeter);
+		});
+
+		dsp::TVuMeter2<float_4> vuMeter4;
+		bench("dsp.VuMeter2.float_4", [&](int64_t n) {
+			for (int64_t i = 0; i < n; i++) {
+				vuMeter4.process(deltaTime, in4(i));
+			}
+			use(vuMeter4);
+		});
+
+		dsp::SchmittTrigger schmitt;
+		bench("dsp.SchmittTrigger", [&](int64_t n) {
+			int count = 0;
+			for (int64_t i = 0; i < n; i++) {
+				count += schmitt.process(in(i));
+			}
+			use(count);
+		});
+
+		dsp::PulseGenerator pulse;
+		bench("dsp.PulseGenerator", [&](int64_t n) {
+			int count = 0;
+			for (int64_t i = 0; i < n; i++) {
+				if ((i & 63) == 0)
+					pulse.trigger(1e-3f);
+				count += pulse.process(deltaTime);
+			}
+			use(count);
+		});
+
+		// Damped harmonic oscillator with 4 voices per state variable
+		bench("dsp.stepRK4.float_4", [&](int64_t n) {
+			float_4 x[2] = {1.f, 0.f};
+			float t = 0.f;
+			for (int64_t i = 0; i < n; i++) {
+				dsp::stepRK4(float_4(t), float_4(deltaTime), x, [&](float_4 t, const float_4 x[], float_4 dxdt[]) {
+					dxdt[0] = x[1];
+					dxdt[1] = -1e5f * x[0] - 10.f * x[1];
+				});
+				t += deltaTime;
+			}
+			use(x);
+		});
+	}
+
+	void runResamplers() {
+		dsp::Decimator<8, 8> decimator;
+		bench("dsp.Decimator.8.8", [&](int64_t n) {
+			float y = 0.f;
+			for (int64_t i = 0; i < n; i++) {
+				y += decimator.process(&input[(i * 8) & INPUT_MASK]);
+			}
+			use(y);
+		});
+
+		dsp::Upsampler<8, 8> upsampler;
+		bench("dsp.Upsampler.8.8", [&](int64_t n) {
+			float out[8];
+			for (int64_t i = 0; i < n; i++) {
+				upsampler.process(in(i), out);
+				use(out);
+			}
+		});
+
+		dsp::MinBlepGenerator<16, 16> minBlep;
+		bench("dsp.MinBlepGenerator.16.16", [&](int64_t n) {
+			float y = 0.f;
+			for (int64_t i = 0; i < n; i++) {
+				// Discontinuity every 32 frames, like a saw wave at 1.5 kHz
+				if ((i & 31) == 0)
+					minBlep.insertDiscontinuity(-0.5f, 2.f);
+				y += minBlep.process();
+			}
+			use(y);
+		});
+
+		// Iterations are output frames
+		dsp::SampleRateConverter<2> src;
+		src.setRates(44100, 48000);
+		bench("dsp.SampleRateConverter.2", [&](int64_t n) {
+			const int len = 256;
+			dsp::Frame<2> out[len];
+			for (int64_t i = 0; i < n;) {
+				int inFrames = INPUT_LEN / 2;
+				int outFrames = std::min<int64_t>(len, n - i);
+				src.process((const dsp::Frame<2>*) input, &inFrames, out, &outFrames);
+				i += std::max(outFrames, 1);
+			}
+			use(out);
+		});
+	}
+
+	void runFft() {
+		// Iterations are transforms
+		const int len = 1024;
+		dsp::RealFFT fft(len);
+		dsp::AlignedBuffer<float> out(len);
+		bench("dsp.RealFFT.1024", [&](int64_t n) {
+			for (int64_t i = 0; i < n; i++) {
+				fft.rfftUnordered(&input[(i * len) & INPUT_MASK], out.data);
+			}
+			use(out.data[0]);
+		});
+
+		// Iterations are transforms, performed in batches covering the whole input
+		const int batch = INPUT_LEN / len;
+		dsp::FftContext context(len);
+		dsp::AlignedBuffer<float> batchOut(INPUT_LEN);
+		bench("dsp.FftContext.1024", [&](int64_t n) {
+			for (int64_t i = 0; i < n; i += batch) {
+				context.forwardUnordered(input, batchOut.data, batch);
+			}
+			use(batchOut.data[0]);
+		});
+
+		// Iterations are blocks of 256 frames convolved with a 1 second kernel
+		const int blockSize = 256;
+		dsp::RealTimeConvolver convolver(blockSize);
+		std::vector<float> kernel(48000);
+		for (size_t i = 0; i < kernel.size(); i++) {
+			kernel[i] = input[i & INPUT_MASK] * std::exp(-5.f * i / kernel.size());
+		}
+		convolver.setKernel(kernel.data(), kernel.size());
+		bench("dsp.RealTimeConvolver.256", [&](int64_t n) {
+			for (int64_t i = 0; i < n; i++) {
+				convolver.processBlock(&input[(i * blockSize) & INPUT_MASK], out.data);
+			}
+			use(out.data[0]);
+		});
+	}
+
+	void runBarrier() {
+		for (int threads = 2; threads <= 32; threads *= 2) {
+			std::string name = string::f("mutex.Barrier.threads.%d", threads);
+			if (!matches(name))
+				continue;
+
+			// Iterations are two crossings, like the engine's barriers in each frame.
+			// This lets helper threads check `running` between crossings, since the main thread can't change it until they all arrive at the second one.
+			Barrier barrier;
+			barrier.setThreads(threads);
+			bool running = true;
+			std::vector<std::thread> helpers;
+			for (int id = 1; id < threads; id++) {
+				helpers.emplace_back([&, id]() {
+					while (true) {
+						barrier.wait(id);
+						if (!running)
+							return;
+						barrier.wait(id);
+					}
+				});
+			}
+			bench(name, [&](int64_t n) {
+				for (int64_t i = 0; i < n; i++) {
+					barrier.wait(0);
+					barrier.wait(0);
+				}
+			});
+			running = false;
+			barrier.wait(0);
+			for (std::thread& helper : helpers) {
+				helper.join();
+			}
+		}
+	}
+
+	/** Replays a MIDI stream delivered in bursts through midi::ClockTracker and checks that the estimated arrival times have much less jitter than the delivery times. */
+	void runMidi() {
+		std::string name = "midi.ClockTracker.replay";
+		if (!matches(name))
+			return;
+
+		// Messages sent every 1 to 3 ms are delivered with 2 ms latency in bursts every 4 ms, plus up to 0.2 ms of scheduling noise.
+		// The driver clock runs 100 ppm slow, and a 2 second pause halfway through makes the tracker reset.
+		const double latency = 0.002;
+		const double burstPeriod = 0.004;
+		const double noise = 0.0002;
+		const double driverRate = 1.0 - 100e-6;
+		const int messages = 20000;
+		// Skip messages shortly after the start and the reset while the estimate settles
+		const double settleTime = 0.1;
+
+		random::Xoroshiro128Plus rng;
+		rng.seed(1, 2);
+		std::uniform_real_distribution<double> distribution(0.0, 1.0);
+		auto uniform = [&]() {
+			return distribution(rng);
+		};
+
+		midi::ClockTracker tracker;
+		double sendTime = 0.0;
+		double resetTime = 0.0;
+		double minDelivered = INFINITY, maxDelivered = -INFINITY;
+		double minEstimated = INFINITY, maxEstimated = -INFINITY;
+		for (int i = 0; i < messages; i++) {
+			double delta = 0.001 + 0.002 * uniform();
+			if (i == messages / 2) {
+				delta = 2.0;
+				resetTime = sendTime + delta;
+			}
+			sendTime += delta;
+			double deliveryTime = std::ceil((sendTime + latency) / burstPeriod) * burstPeriod + noise * uniform();
+			double estimatedTime = tracker.process(delta * driverRate, deliveryTime);
+			if (estimatedTime > deliveryTime)
+				throw Exception("%s: estimated time is later than the delivery time", name.c_str());
+
+			if (sendTime < settleTime || (resetTime <= sendTime && sendTime < resetTime + settleTime))
+				continue;
+			minDelivered = std::min(minDelivered, deliveryTime - sendTime);
+			maxDelivered = std::max(maxDelivered, deliveryTime - sendTime);
+			minEstimated = std::min(minEstimated, estimatedTime - sendTime);
+			maxEstimated = std::max(maxEstimated, estimatedTime - sendTime);
+		}
+
+		double deliveredJitter = maxDelivered - minDelivered;
+		double estimatedJitter = maxEstimated - minEstimated;
+		std::printf("{\"name\": \"%s\", \"messages\": %d, \"deliveredJitterMs\": %.4g, \"estimatedJitterMs\": %.4g}\n", name.c_str(), messages, deliveredJitter * 1e3, estimatedJitter * 1e3);
+		std::fflush(stdout);
+		if (!(estimatedJitter < burstPeriod / 4))
+			throw Exception("%s: jitter of estimated times is %g ms", name.c_str(), estimatedJitter * 1e3);
+	}
+
+	/** Adds and removes items of an RcuList while other threads iterate it, and checks that no reader sees an item after set() has returned without it. */
+	void runRcu() {
+		// Iterations are reads of a list of up to 16 items
+		RcuList<int> benchList;
+		benchList.set({1, 2, 3, 4});
+		bench("rcu.RcuList.Reader", [&](int64_t n) {
+			int sum = 0;
+			for (int64_t i = 0; i < n; i++) {
+				RcuList<int>::Reader reader(benchList);
+				for (int x : reader) {
+					sum += x;
+				}
+			}
+			use(sum);
+		});
+
+		// Iterations are lookups of one of 4 owners, as when a driver thread reads its Device's subscribers
+		RcuListMap<int, int> benchMap;
+		for (int key = 0; key < 4; key++)
+			benchMap.set(key, {1, 2, 3, 4});
+		bench("rcu.RcuListMap.Reader", [&](int64_t n) {
+			int sum = 0;
+			for (int64_t i = 0; i < n; i++) {
+				RcuListMap<int, int>::Reader reader(benchMap, 3);
+				for (int x : reader) {
+					sum += x;
+				}
+			}
+			use(sum);
+		});
+
+		std::string name = "rcu.RcuList.stress";
+		if (!matches(name))
+			return;
+
+		struct Item {
+			/** Set after the item is removed and set() returns, standing in for destroying it */
+			std::atomic<bool> destroyed{true};
+		};
+		const int numItems = 16;
+		const int numReaders = 3;
+		const double duration = 0.5;
+		Item items[numItems];
+		RcuList<Item*> list;
+		std::atomic<bool> running{true};
+		std::atomic<int64_t> reads{0};
+		std::atomic<int64_t> errors{0};
+
+		std::vector<std::thread> readers;
+		for (int t = 0; t < numReaders; t++) {
+			readers.emplace_back([&]() {
+				int64_t localReads = 0;
+				while (running) {
+					RcuList<Item*>::Reader reader(list);
+					for (Item* item : reader) {
+						if (item->destroyed)
+							errors++;
+					}
+					localReads++;
+				}
+				reads += localReads;
+			});
+		}
+
+		// Toggle random items in and out of the list
+		random::Xoroshiro128Plus rng;
+		rng.seed(1, 2);
+		bool present[numItems] = {};
+		int64_t updates = 0;
+		double endTime = system::getTime() + duration;
+		while (system::getTime() < endTime) {
+			int i = rng() % numItems;
+			present[i] = !present[i];
+			if (present[i])
+				items[i].destroyed = false;
+			std::vector<Item*> newItems;
+			for (int j = 0; j < numItems; j++) {
+				if (present[j])
+					newItems.push_back(&items[j]);
+			}
+			list.set(newItems);
+			if (!present[i])
+				items[i].destroyed = true;
+			updates++;
+		}
+
+		running = false;
+		for (std::thread& reader : readers) {
+			reader.join();
+		}
+
+		std::printf("{\"name\": \"%s\", \"readers\": %d, \"updates\": %lld, \"reads\": %lld, \"errors\": %lld}\n", name.c_str(), numReaders, (long long) updates, (long long) reads, (long long) errors);
+		std::fflush(stdout);
+		if (errors > 0)
+			throw Exception("%s: readers saw %lld destroyed items", name.c_str(), (long long) errors.load());
+	}
+
+	void runEngine();
+};
+
+
+/** Mixes its inputs through `cost` nonlinear one-pole filters per channel group, standing in for a plugin module's DSP. */
+struct SyntheticModule : engine::Module {
+	int channels;
+	int cost;
+	float_4 state[4] = {};
+
+	SyntheticModule(int ports, int channels, int cost) {
+		config(0, ports, ports);
+		this->channels = channels;
+		this->cost = cost;
+	}
+
+	void process(const ProcessArgs& args) override {
+		for (int c = 0; c < channels; c += 4) {
+			float_4 y = 0.f;
+			for (engine::Input& input : inputs) {
+				y += input.getPolyVoltageSimd<float_4>(c);
+			}
+			float_4& s = state[c / 4];
+			for (int i = 0; i < cost; i++) {
+				s += (dsp::tanh_pade(y) - s) * 0.1f;
+				y = s;
+			}
+			for (engine::Output& output : outputs) {
+				output.setVoltageSimd(y, c);
+			}
+		}
+		for (engine::Output& output : outputs) {
+			output.setChannels(channels);
+		}
+	}
+};
+
+
+std::string getTopologyName(PatchOptions::Topology topology) {
+	switch (topology) {
+		case PatchOptions::CHAIN: return "chain";
+		case PatchOptions::TREE: return "tree";
+		case PatchOptions::DAG: return "dag";
+		default: return "";
+	}
+}
+
+
+void buildPatch(engine::Engine* engine, const PatchOptions& options) {
+	random::Xoroshiro128Plus rng;
+	rng.seed(options.seed, 0x9e3779b97f4a7c15);
+	auto uniform = [&]() {
+		return (rng() >> 40) * (1.f / (1 << 24));
+	};
+
+	int ports = std::max(options.ports, 1);
+	int channels = math::clamp(options.channels, 1, 16);
+
+	std::vector<engine::Module*> modules;
+	for (int i = 0; i < options.modules; i++) {
+		int cost = std::round(options.cost * (1.f + options.costVariation * (2.f * uniform() - 1.f)));
+		engine::Module* module = new SyntheticModule(ports, channels, std::max(cost, 0));
+		engine->addModule(module);
+		modules.push_back(module);
+	}
+
+	auto connect = [&](int outputModule, int outputId, int inputModule, int inputId) {
+		engine::Cable* cable = new engine::Cable;
+		cable->outputModule = modules[outputModule];
+		cable->outputId = outputId;
+		cable->inputModule = modules[inputModule];
+		cable->inputId = inputId;
+		engine->addCable(cable);
+	};
+
+	int n = modules.size();
+	for (int i = 1; i < n; i++) {
+		switch (options.topology) {
+			case PatchOptions::CHAIN: {
+				for (int p = 0; p < ports; p++) {
+					connect(i - 1, p, i, p);
+				}
+			} break;
+			case PatchOptions::TREE: {
+				connect(i, 0, (i - 1) / ports, (i - 1) % ports);
+			} break;
+			default: break;
+		}
+	}
+	if (options.topology == PatchOptions::DAG) {
+		// Patch each input once, since inputs can only have one cable
+		for (int i = 0; i < n; i++) {
+			for (int p = 0; p < ports; p++) {
+				bool feedback = (i == 0) || (uniform() < options.feedback);
+				if (feedback && i == n - 1)
+					continue;
+				int j = feedback ? (i + 1 + rng() % (n - i - 1)) : (rng() % i);
+				connect(j, rng() % ports, i, p);
+			}
+		}
+	}
+}
+
+
+void Runner::runEngine() {
+	// Iterations are frames, stepped in blocks like an audio device would
+	const int blockSize = 256;
+	int oldThreadCount = settings::threadCount;
+	DEFER({settings::threadCount = oldThreadCount;});
+
+	for (int modules : {0, 16, 256}) {
+		for (int threads : {1, 2, 4}) {
+			std::string name = string::f("engine.chain.%d.threads.%d", modules, threads);
+			if (!matches(name))
+				continue;
+
+			// Measures the engine's own overhead per module and cable
+			PatchOptions options;
+			options.modules = modules;
+			options.ports = 1;
+			options.cost = 0;
+			engine::Engine engine;
+			buildPatch(&engine, options);
+
+			settings::threadCount = threads;
+			bench(name, [&](int64_t n) {
+				for (int64_t i = 0; i < n; i += blockSize) {
+					engine.stepBlock(std::min<int64_t>(blockSize, n - i));
+				}
+			});
+		}
+	}
+}
+
+
+static std::vector<int> parseList(const std::string& s) {
+	std::vector<int> list;
+	for (const std::string& part : string::split(s, ":")) {
+		list.push_back(std::stoi(part));
+	}
+	return list;
+}
+
+
+void runEngine(const std::string& args) {
+	PatchOptions options;
+	std::vector<PatchOptions::Topology> topologies = {PatchOptions::CHAIN, PatchOptions::TREE, PatchOptions::DAG};
+	std::vector<int> threadCounts;
+	for (int threads = 1; threads <= system::getLogicalCoreCount(); threads *= 2) {
+		threadCounts.push_back(threads);
+	}
+	std::vector<int> blockSizes = {64, 256, 1024};
+	double duration = 1.0;
+
+	for (const std::string& arg : string::split(args, ",")) {
+		std::vector<std::string> keyValue = string::split(arg, "=", 2);
+		if (keyValue.size() != 2)
+			throw Exception("Engine benchmark option \"%s\" must be of the form key=value", arg.c_str());
+		const std::string& key = keyValue[0];
+		const std::string& value = keyValue[1];
+		if (key == "topology") {
+			if (value == "all")
+				continue;
+			topologies.clear();
+			for (int t = 0; t < PatchOptions::NUM_TOPOLOGIES; t++) {
+				if (value == getTopologyName((PatchOptions::Topology) t))
+					topologies.push_back((PatchOptions::Topology) t);
+			}
+			if (topologies.empty())
+				throw Exception("Unknown topology \"%s\"", value.c_str());
+		}
+		else if (key == "modules") options.modules = std::stoi(value);
+		else if (key == "ports") options.ports = std::stoi(value);
+		else if (key == "channels") options.channels = std::stoi(value);
+		else if (key == "cost") options.cost = std::stoi(value);
+		else if (key == "costVariation") options.costVariation = std::stof(value);
+		else if (key == "feedback") options.feedback = std::stof(value);
+		else if (key == "seed") options.seed = std::stoull(value);
+		else if (key == "threads") threadCounts = parseList(value);
+		else if (key == "blocks") blockSizes = parseList(value);
+		else if (key == "duration") duration = std::stod(value);
+		else
+			throw Exception("Unknown engine benchmark option \"%s\"", key.c_str());
+	}
+
+	int oldThreadCount = settings::threadCount;
+	DEFER({settings::threadCount = oldThreadCount;});
+
+	for (PatchOptions::Topology topology : topologies) {
+		options.topology = topology;
+		std::string topologyName = getTopologyName(topology);
+		INFO("Benchmarking %s of %d modules", topologyName.c_str(), options.modules);
+		engine::Engine engine;
+		buildPatch(&engine, options);
+		float sampleRate = engine.getSampleRate();
+
+		for (int blockSize : blockSizes) {
+			double baseFramesPerSecond = 0.0;
+			int baseThreads = 0;
+			for (int threads : threadCounts) {
+				settings::threadCount = threads;
+				// Warm up workers and caches
+				double warmupEndTime = system::getTime() + 0.1;
+				while (system::getTime() < warmupEndTime) {
+					engine.stepBlock(blockSize);
+				}
+
+				std::vector<double> frameNs;
+				double startTime = system::getTime();
+				double endTime = startTime;
+				while (endTime - startTime < duration) {
+					engine.stepBlock(blockSize);
+					double time = system::getTime();
+					frameNs.push_back((time - endTime) * 1e9 / blockSize);
+					endTime = time;
+				}
+				double framesPerSecond = frameNs.size() * blockSize / (endTime - startTime);
+				if (baseThreads == 0) {
+					baseFramesPerSecond = framesPerSecond;
+					baseThreads = threads;
+				}
+				double efficiency = (framesPerSecond / baseFramesPerSecond) / ((double) threads / baseThreads);
+
+				std::sort(frameNs.begin(), frameNs.end());
+				auto percentile = [&](double p) {
+					return frameNs[std::min<size_t>(frameNs.size() * p, frameNs.size() - 1)];
+				};
+				std::printf("{\"topology\": \"%s\", \"modules\": %d, \"ports\": %d, \"channels\": %d, \"cost\": %d, \"threads\": %d, \"blockSize\": %d, \"framesPerSecond\": %.6g, \"realtime\": %.4g, \"frameNsP50\": %.4g, \"frameNsP90\": %.4g, \"frameNsP99\": %.4g, \"frameNsMax\": %.4g, \"efficiency\": %.3f}\n",
+					topologyName.c_str(), options.modules, options.ports, options.channels, options.cost, threads, blockSize,
+					framesPerSecond, framesPerSecond / sampleRate, percentile(0.5), percentile(0.9), percentile(0.99), frameNs.back(), efficiency);
+				std::fflush(stdout);
+			}
+		}
+	}
+}
+
+
+void run(const std::string& filter) {
+	INFO("Running benchmarks matching \"%s\"", filter.c_str());
+	Runner runner(filter);
+	runner.runMath();
+	runner.runRandom();
+	runner.runFilters();
+	runner.runResamplers();
+	runner.runFft();
+	runner.runBarrier();
+	runner.runMidi();
+	runner.runRcu();
+	runner.runEngine();
+	INFO("Finished benchmarks");
+}
+
+
+} // namespace bench
+} // namespace rack
@@ -2,6 +2,7 @@
 #include <chrono>
 #include <thread>
 #include <condition_variable>
+#include <atomic>
 
 #include "plugin.hpp"
 #include <audio.hpp>
@@ -12,16 +13,74 @@ namespace rack {
 namespace core {
 
 
+/** Corrects the rate of a SampleRateConverter to keep a buffer between two clocks at a target fill level.
+Used by secondary audio devices, whose clocks drift relative to the engine, which is clocked by the master device.
+*/
+struct DriftCompensator {
+	/** Smoothed buffer fill level in frames, or NAN before the first measurement */
+	float fill = NAN;
+	/** Last correction applied to the converter, or NAN if the converter has its nominal ratio */
+	double correction = NAN;
+
+	void reset() {
+		fill = NAN;
+	}
+
+	/** Sets the ratio of `src` for consuming the buffer, given its current size and target size.
+	A correction above 1 drains the buffer faster.
+	Must be called every block, since changing the rates of `src` resets its ratio.
+	*/
+	template <class TSampleRateConverter>
+	void process(TSampleRateConverter& src, float size, float target) {
+		if (!std::isfinite(fill))
+			fill = size;
+		// Average over roughly 100 device blocks, since the instantaneous fill level depends on the phase between the two devices' callbacks.
+		fill += (size - fill) * 0.01f;
+		correction = 1.0;
+		if (target > 0.f) {
+			// Proportional control, which settles within a few seconds and is stable for drift well beyond what real devices exhibit.
+			double error = (fill - target) / target;
+			// Quantize so the ratio only changes occasionally
+			correction += std::round(std::fmax(std::fmin(error * 0.002, 0.005), -0.005) * 1e6) / 1e6;
+		}
+		// Speex reduces the fraction, so scale both terms for sub-ppm resolution.
+		src.setRateFraction(std::round(src.inRate * correction * 1000.0), src.outRate * 1000);
+	}
+
+	/** Resets `src` to its nominal ratio if it was corrected, e.g. when the device becomes the master. */
+	template <class TSampleRateConverter>
+	void stop(TSampleRateConverter& src) {
+		reset();
+		if (!std::isnan(correction)) {
+			correction = NAN;
+			src.refreshState();
+		}
+	}
+};
+
+
 template <int NUM_AUDIO_INPUTS, int NUM_AUDIO_OUTPUTS>
 struct AudioPort : audio::Port {
 	Module* module;
 
-	dsp::DoubleRingBuffer<dsp::Frame<NUM_AUDIO_INPUTS>, 32768> engineInputBuffer;
-	dsp::DoubleRingBuffer<dsp::Frame<NUM_AUDIO_OUTPUTS>, 32768> engineOutputBuffer;
+	/** Pushed by the engine thread, consumed by the device thread */
+	dsp::SpscRingBuffer<dsp::Frame<NUM_AUDIO_INPUTS>> engineInputBuffer;
+	/** Pushed by the device thread, consumed by the engine thread */
+	dsp::SpscRingBuffer<dsp::Frame<NUM_AUDIO_OUTPUTS>> engineOutputBuffer;
+	/** Only the consumer of a buffer may clear it, so other threads request it with these flags. */
+	std::atomic<bool> engineInputClearRequest{false};
+	std::atomic<bool> engineOutputClearRequest{false};
+	/** Set by the engine thread while it accesses the buffers, and by the device thread while it reallocates them. */
+	std::atomic<bool> engineBusy{false};
+	std::atomic<bool> resizing{false};
 
 	dsp::SampleRateConverter<NUM_AUDIO_INPUTS> inputSrc;
 	dsp::SampleRateConverter<NUM_AUDIO_OUTPUTS> outputSrc;
 
+	/** Drift compensation for engineInputBuffer and engineOutputBuffer when not master */
+	DriftCompensator inputDrift;
+	DriftCompensator outputDrift;
+
 	// Port variable caches
 	int deviceNumInputs = 0;
 	int deviceNumOutputs = 0;
@@ -51,7 +110,44 @@ struct AudioPort : audio::Port {
 		return APP->engine->getMasterModule() == module;
 	}
 
+	/** Called by the engine thread before accessing the buffers.
+	Returns false if the device thread is reallocating them, in which case the engine skips this frame.
+	*/
+	bool engineLock() {
+		engineBusy = true;
+		if (resizing) {
+			engineBusy = false;
+			return false;
+		}
+		return true;
+	}
+
+	void engineUnlock() {
+		engineBusy = false;
+	}
+
+	/** Sizes the buffers to hold several device blocks of engine frames.
+	Called by the device thread, so this only allocates when the block size or sample rates change.
+	*/
+	void updateCapacity(int frames, float sampleRateRatio) {
+		// Secondary devices clear their buffers beyond 4 blocks, so leave room for that plus the block being written.
+		size_t capacity = std::max((size_t) std::ceil(frames * sampleRateRatio * 8.0), (size_t) 256);
+		size_t currentCapacity = engineInputBuffer.getCapacity();
+		if (capacity <= currentCapacity && capacity * 4 > currentCapacity)
+			return;
+
+		resizing = true;
+		while (engineBusy)
+			std::this_thread::yield();
+		engineInputBuffer.setCapacity(capacity);
+		engineOutputBuffer.setCapacity(capacity);
+		resizing = false;
+		inputDrift.reset();
+		outputDrift.reset();
+	}
+
 	void processInput(const float* input, int inputStride, int frames) override {
+		TRACE_SCOPE("AudioPort::processInput");
 		deviceNumInputs = std::min(getNumInputs(), NUM_AUDIO_OUTPUTS);
 		deviceNumOutputs = std::min(getNumOutputs(), NUM_AUDIO_INPUTS);
 		deviceSampleRate = getSampleRate();
@@ -70,29 +166,52 @@ struct AudioPort : audio::Port {
 
 		float engineSampleRate = APP->engine->getSampleRate();
 		float sampleRateRatio = engineSampleRate / deviceSampleRate;
+		updateCapacity(frames, sampleRateRatio);
 
 		// DEBUG("%p: %d block, engineOutputBuffer still has %d", this, frames, (int) engineOutputBuffer.size());
 
-		// Consider engine buffers "too full" if they contain a bit more than the audio device's number of frames, converted to engine sample rate.
-		int maxEngineFrames = (int) std::ceil(frames * sampleRateRatio * 2.0) - 1;
+		// Secondary devices keep about one device block of engine frames buffered and correct their resampling rate to follow drift between the device and engine clocks.
+		float targetEngineFrames = frames * sampleRateRatio;
+		// Consider engine buffers "too full" if drift compensation can't keep up, e.g. after a stall.
+		int maxEngineFrames = (int) std::ceil(targetEngineFrames * 4.0) - 1;
 		// If the engine output buffer is too full, clear it to keep latency low. No need to clear if master because it's always cleared below.
 		if (!isMasterCached && (int) engineOutputBuffer.size() > maxEngineFrames) {
-			engineOutputBuffer.clear();
+			engineOutputClearRequest = true;
+			outputDrift.reset();
 			// DEBUG("%p: clearing engine output", this);
 		}
 
 		if (deviceNumInputs > 0) {
-			// Always clear engine output if master
+			// Always clear engine output if master.
+			// The master's engine runs on this thread, so it's safe to clear directly.
 			if (isMasterCached) {
 				engineOutputBuffer.clear();
+				engineOutputClearRequest = false;
 			}
 			// Set up sample rate converter
 			outputSrc.setRates(deviceSampleRate, engineSampleRate);
 			outputSrc.setChannels(deviceNumInputs);
-			int inputFrames = frames;
-			int outputFrames = engineOutputBuffer.capacity();
-			outputSrc.process(input, inputStride, &inputFrames, (float*) engineOutputBuffer.endData(), NUM_AUDIO_OUTPUTS, &outputFrames);
-			engineOutputBuffer.endIncr(outputFrames);
+			if (isMasterCached) {
+				outputDrift.stop(outputSrc);
+			}
+			else {
+				// Produce fewer engine frames per device frame if frames accumulate, because the device clock is faster than the engine's.
+				outputDrift.process(outputSrc, engineOutputBuffer.size(), targetEngineFrames);
+			}
+			// Write up to the wraparound point, then write the rest
+			int inputFramesRemaining = frames;
+			for (int i = 0; i < 2 && inputFramesRemaining > 0; i++) {
+				size_t n;
+				dsp::Frame<NUM_AUDIO_OUTPUTS>* out = engineOutputBuffer.endData(&n);
+				if (n == 0)
+					break;
+				int inputFrames = inputFramesRemaining;
+				int outputFrames = n;
+				outputSrc.process(input, inputStride, &inputFrames, (float*) out, NUM_AUDIO_OUTPUTS, &outputFrames);
+				engineOutputBuffer.endIncr(outputFrames);
+				input += inputFrames * inputStride;
+				inputFramesRemaining -= inputFrames;
+			}
 			// Request exactly as many frames as we have in the engine output buffer.
 			requestedEngineFrames = engineOutputBuffer.size();
 		}
@@ -111,19 +230,34 @@ struct AudioPort : audio::Port {
 	}
 
 	void processOutput(float* output, int outputStride, int frames) override {
-		// bool isMasterCached = isMaster();
+		TRACE_SCOPE("AudioPort::processOutput");
+		bool isMasterCached = isMaster();
 		float engineSampleRate = APP->engine->getSampleRate();
 		float sampleRateRatio = engineSampleRate / deviceSampleRate;
 
+		if (engineInputClearRequest.exchange(false)) {
+			engineInputBuffer.clear();
+			inputDrift.reset();
+		}
+
 		if (deviceNumOutputs > 0) {
 			// Set up sample rate converter
 			inputSrc.setRates(engineSampleRate, deviceSampleRate);
 			inputSrc.setChannels(deviceNumOutputs);
 			// Convert engine input -> audio output
-			int inputFrames = engineInputBuffer.size();
-			int outputFrames = frames;
-			inputSrc.process((const float*) engineInputBuffer.startData(), NUM_AUDIO_INPUTS, &inputFrames, output, outputStride, &outputFrames);
-			engineInputBuffer.startIncr(inputFrames);
+			// Read up to the wraparound point, then read the rest
+			int outputFrames = 0;
+			for (int i = 0; i < 2 && outputFrames < frames; i++) {
+				size_t n;
+				const dsp::Frame<NUM_AUDIO_INPUTS>* in = engineInputBuffer.startData(&n);
+				if (n == 0)
+					break;
+				int inputFrames = n;
+				int outputFramesWritten = frames - outputFrames;
+				inputSrc.process((const float*) in, NUM_AUDIO_INPUTS, &inputFrames, output + outputFrames * outputStride, outputStride, &outputFramesWritten);
+				engineInputBuffer.startIncr(inputFrames);
+				outputFrames += outputFramesWritten;
+			}
 			// Clamp output samples
 			for (int i = 0; i < outputFrames; i++) {
 				for (int j = 0; j < deviceNumOutputs; j++) {
@@ -142,10 +276,21 @@ struct AudioPort : audio::Port {
 
 		// DEBUG("%p: %d block, engineInputBuffer left %d", this, frames, (int) engineInputBuffer.size());
 
+		float targetEngineFrames = frames * sampleRateRatio;
+		if (isMasterCached) {
+			inputDrift.stop(inputSrc);
+		}
+		else {
+			// Consume engine frames faster next block if they accumulate, because the engine clock is faster than the device's.
+			inputDrift.process(inputSrc, engineInputBuffer.size(), targetEngineFrames);
+		}
+
 		// If the engine input buffer is too full, clear it to keep latency low.
-		int maxEngineFrames = (int) std::ceil(frames * sampleRateRatio * 2.0) - 1;
+		// Secondary devices are allowed more slack since drift compensation keeps them near one block.
+		int maxEngineFrames = (int) std::ceil(targetEngineFrames * (isMasterCached ? 2.0 : 4.0)) - 1;
 		if ((int) engineInputBuffer.size() > maxEngineFrames) {
 			engineInputBuffer.clear();
+			inputDrift.reset();
 			// DEBUG("%p: clearing engine input", this);
 		}
 
@@ -153,8 +298,10 @@ struct AudioPort : audio::Port {
 	}
 
 	void onStartStream() override {
-		engineInputBuffer.clear();
-		engineOutputBuffer.clear();
+		engineInputClearRequest = true;
+		engineOutputClearRequest = true;
+		inputDrift.reset();
+		outputDrift.reset();
 		// DEBUG("onStartStream");
 	}
 
@@ -162,8 +309,10 @@ struct AudioPort : audio::Port {
 		deviceNumInputs = 0;
 		deviceNumOutputs = 0;
 		deviceSampleRate = 0.f;
-		engineInputBuffer.clear();
-		engineOutputBuffer.clear();
+		engineInputClearRequest = true;
+		engineOutputClearRequest = true;
+		inputDrift.reset();
+		outputDrift.reset();
 		// We can be in an Engine write-lock here (e.g. onReset() calls this indirectly), so use non-locking master module API.
 		// setMaster(false);
 		if (APP->engine->getMasterModule() == module)
@@ -246,8 +395,8 @@ struct Audio : Module {
 	}
 
 	void onSampleRateChange(const SampleRateChangeEvent& e) override {
-		port.engineInputBuffer.clear();
-		port.engineOutputBuffer.clear();
+		port.engineInputClearRequest = true;
+		port.engineOutputClearRequest = true;
 
 		for (int i = 0; i < NUM_AUDIO_INPUTS; i++) {
 			dcFilters[i].setCutoffFreq(10.f * e.sampleTime);
@@ -256,6 +405,7 @@ struct Audio : Module {
 
 	void process(const ProcessArgs& args) override {
 		const float clipTime = 0.25f;
+		bool buffersLocked = port.engineLock();
 
 		// Push inputs to buffer
 		if (port.deviceNumOutputs > 0) {
@@ -291,7 +441,7 @@ struct Audio : Module {
 				}
 			}
 
-			if (!port.engineInputBuffer.full()) {
+			if (buffersLocked && !port.engineInputBuffer.full()) {
 				port.engineInputBuffer.push(inputFrame);
 			}
 
@@ -312,8 +462,19 @@ struct Audio : Module {
 		}
 
 		// Pull outputs from buffer
-		if (!port.engineOutputBuffer.empty()) {
-			dsp::Frame<NUM_AUDIO_OUTPUTS> outputFrame = port.engineOutputBuffer.shift();
+		bool hasOutputFrame = false;
+		dsp::Frame<NUM_AUDIO_OUTPUTS> outputFrame;
+		if (buffersLocked) {
+			if (port.engineOutputClearRequest.load(std::memory_order_relaxed) && port.engineOutputClearRequest.exchange(false)) {
+				port.engineOutputBuffer.clear();
+			}
+			if (!port.engineOutputBuffer.empty()) {
+				outputFrame = port.engineOutputBuffer.shift();
+				hasOutputFrame = true;
+			}
+			port.engineUnlock();
+		}
+		if (hasOutputFrame) {
 			for (int i = 0; i < NUM_AUDIO_OUTPUTS; i++) {
 				float v = outputFrame.samples[i];
 				outputs[AUDIO_OUTPUTS + i].setVoltage(10.f * v);
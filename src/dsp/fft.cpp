@@ -0,0 +1,55 @@
+#include <map>
+#include <mutex>
+
+#include <dsp/fft.hpp>
+
+
+namespace rack {
+namespace dsp {
+
+
+bool isFftLengthValid(int length, pffft_transform_t type) {
+	int multiple = (type == PFFFT_REAL) ? 32 : 16;
+	if (length <= 0 || length % multiple != 0)
+		return false;
+	for (int factor : {2, 3, 5}) {
+		while (length % factor == 0)
+			length /= factor;
+	}
+	return length == 1;
+}
+
+
+int getFftLength(int length, pffft_transform_t type) {
+	int multiple = (type == PFFFT_REAL) ? 32 : 16;
+	int n = std::max(1, (length + multiple - 1) / multiple) * multiple;
+	while (!isFftLengthValid(n, type))
+		n += multiple;
+	return n;
+}
+
+
+static std::map<std::pair<int, pffft_transform_t>, PFFFT_Setup*> setups;
+static std::mutex setupsMutex;
+
+
+PFFFT_Setup* getFftSetup(int length, pffft_transform_t type) {
+	std::lock_guard<std::mutex> lock(setupsMutex);
+	auto key = std::make_pair(length, type);
+	auto it = setups.find(key);
+	if (it != setups.end())
+		return it->second;
+
+	// PFFFT asserts on some invalid lengths, so check first.
+	if (!isFftLengthValid(length, type))
+		throw Exception("FFT length %d is not supported", length);
+	PFFFT_Setup* setup = pffft_new_setup(length, type);
+	if (!setup)
+		throw Exception("Could not create FFT setup of length %d", length);
+	setups[key] = setup;
+	return setup;
+}
+
+
+} // namespace dsp
+} // namespace rack
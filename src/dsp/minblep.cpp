@@ -1,3 +1,7 @@
+#include <map>
+#include <mutex>
+#include <vector>
+
 #include <dsp/minblep.hpp>
 #include <dsp/fft.hpp>
 #include <dsp/window.hpp>
@@ -7,7 +11,7 @@ namespace rack {
 namespace dsp {
 
 
-void minBlepImpulse(int z, int o, float* output) {
+static void computeMinBlepImpulse(int z, int o, float* output) {
 	// Symmetric sinc array with `z` zero-crossings on each side
 	int n = 2 * z * o;
 	float* x = new float[n];
@@ -80,5 +84,22 @@ void minBlepImpulse(int z, int o, float* output) {
 }
 
 
+static std::map<std::pair<int, int>, std::vector<float>> impulses;
+static std::mutex impulsesMutex;
+
+
+void minBlepImpulse(int z, int o, float* output) {
+	// Every MinBlepGenerator with the same parameters needs the same impulse, so only compute it once.
+	std::lock_guard<std::mutex> lock(impulsesMutex);
+	std::vector<float>& impulse = impulses[std::make_pair(z, o)];
+	int n = 2 * z * o;
+	if (impulse.empty()) {
+		impulse.resize(n);
+		computeMinBlepImpulse(z, o, impulse.data());
+	}
+	std::memcpy(output, impulse.data(), n * sizeof(float));
+}
+
+
 } // namespace dsp
 } // namespace rack
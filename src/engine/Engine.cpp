@@ -17,6 +17,7 @@
 #include <patch.hpp>
 #include <plugin.hpp>
 #include <mutex.hpp>
+#include <trace.hpp>
 
 
 namespace rack {
@@ -35,130 +36,6 @@ static void initMXCSR() {
 #endif
 
 
-/** Barrier based on mutexes.
-Not finished or tested, do not use.
-*/
-struct Barrier {
-	int count = 0;
-	uint8_t step = 0;
-	int threads = 0;
-
-	std::mutex mutex;
-	std::condition_variable cv;
-
-	void setThreads(int threads) {
-		this->threads = threads;
-	}
-
-	void wait() {
-		std::unique_lock<std::mutex> lock(mutex);
-		uint8_t s = step;
-		if (++count >= threads) {
-			// We're the last thread. Reset next phase.
-			count = 0;
-			// Allow other threads to exit wait()
-			step++;
-			cv.notify_all();
-			return;
-		}
-
-		cv.wait(lock, [&] {
-			return step != s;
-		});
-	}
-};
-
-
-/** 2-phase barrier based on spin-locking.
-*/
-struct SpinBarrier {
-	std::atomic<int> count{0};
-	std::atomic<uint8_t> step{0};
-	int threads = 0;
-
-	/** Must be called when no threads are calling wait().
-	*/
-	void setThreads(int threads) {
-		this->threads = threads;
-	}
-
-	void wait() {
-		uint8_t s = step;
-		if (count.fetch_add(1, std::memory_order_acquire) + 1 >= threads) {
-			// We're the last thread. Reset next phase.
-			count = 0;
-			// Allow other threads to exit wait()
-			step++;
-			return;
-		}
-
-		// Spin until the last thread begins waiting
-		while (true) {
-			if (step.load(std::memory_order_relaxed) != s)
-				return;
-#if defined ARCH_X64
-			__builtin_ia32_pause();
-#endif
-		}
-	}
-};
-
-
-/** Barrier that spin-locks until yield() is called, and then all threads switch to a mutex.
-yield() should be called if it is likely that all threads will block for a while and continuing to spin-lock is unnecessary.
-Saves CPU power after yield is called.
-*/
-struct HybridBarrier {
-	std::atomic<int> count{0};
-	std::atomic<uint8_t> step{0};
-	int threads = 0;
-
-	std::atomic<bool> yielded{false};
-	std::mutex mutex;
-	std::condition_variable cv;
-
-	void setThreads(int threads) {
-		this->threads = threads;
-	}
-
-	void yield() {
-		yielded = true;
-	}
-
-	void wait() {
-		uint8_t s = step;
-		if (count.fetch_add(1, std::memory_order_acquire) + 1 >= threads) {
-			// We're the last thread. Reset next phase.
-			count = 0;
-			bool wasYielded = yielded;
-			yielded = false;
-			// Allow other threads to exit wait()
-			step++;
-			if (wasYielded) {
-				std::unique_lock<std::mutex> lock(mutex);
-				cv.notify_all();
-			}
-			return;
-		}
-
-		// Spin until the last thread begins waiting
-		while (!yielded.load(std::memory_order_relaxed)) {
-			if (step.load(std::memory_order_relaxed) != s)
-				return;
-#if defined ARCH_X64
-			__builtin_ia32_pause();
-#endif
-		}
-
-		// Wait on mutex CV
-		std::unique_lock<std::mutex> lock(mutex);
-		cv.wait(lock, [&] {
-			return step != s;
-		});
-	}
-};
-
-
 struct EngineWorker {
 	Engine* engine;
 	int id;
@@ -188,6 +65,8 @@ struct EngineWorker {
 
 struct Engine::Internal {
 	std::vector<Module*> modules;
+	/** Nanoseconds spent in the worker barrier during the current block, while tracing */
+	int64_t traceBarrierTime = 0;
 	std::vector<Cable*> cables;
 	std::set<ParamHandle*> paramHandles;
 	Module* masterModule = NULL;
@@ -231,8 +110,10 @@ struct Engine::Internal {
 
 	int threadCount = 0;
 	std::vector<EngineWorker> workers;
-	HybridBarrier engineBarrier;
-	HybridBarrier workerBarrier;
+	/** Crossed by all threads at the start of each frame, after cables are stepped. */
+	Barrier engineBarrier;
+	/** Crossed by all threads after stepping modules. */
+	Barrier workerBarrier;
 	std::atomic<int> workerModuleIndex;
 	// For worker threads
 	Context* context;
@@ -278,7 +159,7 @@ static void Engine_relaunchWorkers(Engine* that, int threadCount) {
 		for (EngineWorker& worker : internal->workers) {
 			worker.requestStop();
 		}
-		internal->engineBarrier.wait();
+		internal->engineBarrier.wait(0);
 
 		// Join and destroy engine workers
 		for (EngineWorker& worker : internal->workers) {
@@ -399,9 +280,17 @@ static void Engine_stepFrame(Engine* that) {
 
 	// Step modules along with workers
 	internal->workerModuleIndex = 0;
-	internal->engineBarrier.wait();
+	internal->engineBarrier.wait(0);
 	Engine_stepWorker(that, 0);
-	internal->workerBarrier.wait();
+	if (trace::isEnabled()) {
+		// Time spent waiting for other workers to finish, accumulated over the block
+		int64_t barrierStartTime = trace::getTime();
+		internal->workerBarrier.wait(0);
+		internal->traceBarrierTime += trace::getTime() - barrierStartTime;
+	}
+	else {
+		internal->workerBarrier.wait(0);
+	}
 
 	internal->frame++;
 }
@@ -531,6 +420,7 @@ void Engine::clear_NoLock() {
 
 
 void Engine::stepBlock(int frames) {
+	TRACE_SCOPE("Engine::stepBlock");
 	// Start timer before locking
 	double startTime = system::getTime();
 
@@ -557,11 +447,15 @@ void Engine::stepBlock(int frames) {
 	Engine_relaunchWorkers(this, settings::threadCount);
 
 	// Step individual frames
+	internal->traceBarrierTime = 0;
 	for (int i = 0; i < frames; i++) {
 		Engine_stepFrame(this);
 	}
+	trace::counter("Engine worker barrier wait (us)", internal->traceBarrierTime / 1e3);
+	trace::counter("Engine block frames", frames);
 
-	yieldWorkers();
+	// Workers wait at engineBarrier until the next block, so park them now instead of letting them spin.
+	internal->engineBarrier.yield();
 
 	internal->block++;
 
@@ -1310,13 +1204,20 @@ void EngineWorker::run() {
 	initMXCSR();
 #endif
 	random::init();
+	int64_t block = -1;
 
 	while (true) {
-		engine->internal->engineBarrier.wait();
+		engine->internal->engineBarrier.wait(id);
 		if (!running)
 			return;
+		// Follow changes to the master random seed at the start of each block, like the engine thread does in stepBlock()
+		// The engine thread only changes `block` while workers wait at engineBarrier, so it's safe to read here.
+		if (engine->internal->block != block) {
+			block = engine->internal->block;
+			random::init();
+		}
 		Engine_stepWorker(engine, id);
-		engine->internal->workerBarrier.wait();
+		engine->internal->workerBarrier.wait(id);
 	}
 }
 
@@ -1,4 +1,10 @@
 #include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <algorithm>
 
 #include <common.hpp>
 #include <asset.hpp>
@@ -13,10 +19,204 @@ namespace logger {
 
 std::string logPath;
 static FILE* outputFile = NULL;
-static std::mutex mutex;
+/** Held while writing to `outputFile` and while consuming rings. */
+static std::timed_mutex mutex;
 static bool truncated = false;
 
 
+/** Single-producer single-consumer byte queue of formatted lines.
+Each thread that logs owns a Ring and is its only producer.
+The consumer is whoever holds `mutex`.
+*/
+struct Ring {
+	static constexpr size_t SIZE = 1 << 16;
+	char data[SIZE];
+	/** Total bytes written by the producer */
+	std::atomic<size_t> head{0};
+	/** Total bytes read by the consumer */
+	std::atomic<size_t> tail{0};
+	/** Cleared when the owning thread exits */
+	std::atomic<bool> alive{true};
+
+	/** Each record is a header followed by `size` bytes of text. */
+	struct Header {
+		double time;
+		size_t size;
+	};
+
+	void copyIn(size_t pos, const void* src, size_t size) {
+		size_t i = pos % SIZE;
+		size_t n = std::min(size, SIZE - i);
+		std::memcpy(&data[i], src, n);
+		std::memcpy(&data[0], (const char*) src + n, size - n);
+	}
+
+	void copyOut(size_t pos, void* dst, size_t size) {
+		size_t i = pos % SIZE;
+		size_t n = std::min(size, SIZE - i);
+		std::memcpy(dst, &data[i], n);
+		std::memcpy((char*) dst + n, &data[0], size - n);
+	}
+
+	/** Returns false if there is not enough space. */
+	bool push(double time, const char* text, size_t size) {
+		size_t h = head.load(std::memory_order_relaxed);
+		size_t t = tail.load(std::memory_order_acquire);
+		if (sizeof(Header) + size > SIZE - (h - t))
+			return false;
+		Header header = {time, size};
+		copyIn(h, &header, sizeof(header));
+		copyIn(h + sizeof(header), text, size);
+		head.store(h + sizeof(header) + size, std::memory_order_release);
+		return true;
+	}
+
+	bool empty() {
+		return head.load(std::memory_order_acquire) == tail.load(std::memory_order_relaxed);
+	}
+};
+
+
+/** A line popped from a Ring, waiting to be written */
+struct Line {
+	double time;
+	std::string text;
+};
+
+
+/** All rings, including those of exited threads that haven't been drained yet. */
+static std::vector<std::shared_ptr<Ring>> rings;
+/** Guards `rings` and `pendingThreadRings` */
+static std::mutex ringsMutex;
+
+
+/** The Ring of a thread, which is created by the flusher thread after the thread first logs.
+Until then, the thread writes its lines to the file while holding `mutex`.
+This way real-time threads such as audio callbacks never allocate a Ring or lock `ringsMutex` to log.
+*/
+struct ThreadRing {
+	std::atomic<Ring*> ring{NULL};
+	bool requested = false;
+	/** Next ThreadRing in `pendingThreadRings` */
+	ThreadRing* nextPending = NULL;
+
+	~ThreadRing();
+};
+
+static thread_local ThreadRing threadRing;
+/** Linked list of ThreadRings waiting for the flusher thread to create their Ring */
+static ThreadRing* pendingThreadRings = NULL;
+
+
+ThreadRing::~ThreadRing() {
+	std::lock_guard<std::mutex> lock(ringsMutex);
+	// Cancel the request if the Ring hasn't been created yet
+	for (ThreadRing** p = &pendingThreadRings; *p; p = &(*p)->nextPending) {
+		if (*p == this) {
+			*p = nextPending;
+			break;
+		}
+	}
+	Ring* r = ring.load();
+	if (r)
+		r->alive = false;
+}
+
+
+/** Asks the flusher thread to create a Ring for the current thread.
+Doesn't allocate, since it's called by threads logging their first line.
+*/
+static void requestThreadRing() {
+	if (threadRing.requested)
+		return;
+	threadRing.requested = true;
+	std::lock_guard<std::mutex> lock(ringsMutex);
+	threadRing.nextPending = pendingThreadRings;
+	pendingThreadRings = &threadRing;
+}
+
+
+/** Creates the Rings of threads that have requested them. Called by the flusher thread. */
+static void createThreadRings() {
+	std::lock_guard<std::mutex> lock(ringsMutex);
+	while (pendingThreadRings) {
+		ThreadRing* tr = pendingThreadRings;
+		pendingThreadRings = tr->nextPending;
+		tr->nextPending = NULL;
+		std::shared_ptr<Ring> ring = std::make_shared<Ring>();
+		rings.push_back(ring);
+		tr->ring.store(ring.get(), std::memory_order_release);
+	}
+}
+
+
+/** Background flusher */
+static std::thread flushThread;
+static std::mutex flushMutex;
+static std::condition_variable flushCv;
+static bool flushRunning = false;
+/** Interval between background flushes in seconds */
+static const double FLUSH_INTERVAL = 0.1;
+
+
+/** Drains all rings into the output file in time order.
+Caller must hold `mutex`.
+*/
+static void drainRings() {
+	std::vector<std::shared_ptr<Ring>> ringsCopy;
+	{
+		std::lock_guard<std::mutex> lock(ringsMutex);
+		// Forget rings of exited threads once they are empty
+		rings.erase(std::remove_if(rings.begin(), rings.end(), [](const std::shared_ptr<Ring>& ring) {
+			return !ring->alive && ring->empty();
+		}), rings.end());
+		ringsCopy = rings;
+	}
+
+	std::vector<Line> lines;
+	for (const std::shared_ptr<Ring>& ring : ringsCopy) {
+		size_t t = ring->tail.load(std::memory_order_relaxed);
+		size_t h = ring->head.load(std::memory_order_acquire);
+		while (t != h) {
+			Ring::Header header;
+			ring->copyOut(t, &header, sizeof(header));
+			Line line;
+			line.time = header.time;
+			line.text.resize(header.size);
+			ring->copyOut(t + sizeof(header), &line.text[0], header.size);
+			lines.push_back(std::move(line));
+			t += sizeof(header) + header.size;
+		}
+		ring->tail.store(t, std::memory_order_release);
+	}
+
+	if (lines.empty())
+		return;
+	// Each ring is already in order, so a stable sort interleaves threads without reordering any one thread's lines.
+	std::stable_sort(lines.begin(), lines.end(), [](const Line& a, const Line& b) {
+		return a.time < b.time;
+	});
+	if (!outputFile)
+		return;
+	for (const Line& line : lines) {
+		std::fwrite(line.text.data(), 1, line.text.size(), outputFile);
+	}
+	std::fflush(outputFile);
+}
+
+
+static void flushRun() {
+	system::setThreadName("Logger");
+	std::unique_lock<std::mutex> flushLock(flushMutex);
+	while (flushRunning) {
+		flushCv.wait_for(flushLock, std::chrono::duration<double>(FLUSH_INTERVAL));
+		createThreadRings();
+		std::lock_guard<std::timed_mutex> lock(mutex);
+		drainRings();
+	}
+}
+
+
 static bool fileEndsWith(FILE* file, std::string str) {
 	// Seek to last `len` characters
 	size_t len = str.size();
@@ -48,7 +248,7 @@ static bool isTruncated() {
 
 void init() {
 	assert(!outputFile);
-	std::lock_guard<std::mutex> lock(mutex);
+	std::lock_guard<std::timed_mutex> lock(mutex);
 	truncated = false;
 
 	// Don't open a file in development mode.
@@ -68,10 +268,23 @@ void init() {
 	// Actually, disable this because we don't want to steal stdout/stderr from the DAW in Rack for DAWs.
 	// dup2(fileno(outputFile), fileno(stdout));
 	// dup2(fileno(outputFile), fileno(stderr));
+
+	flushRunning = true;
+	flushThread = std::thread(flushRun);
 }
 
 void destroy() {
-	std::lock_guard<std::mutex> lock(mutex);
+	if (flushThread.joinable()) {
+		{
+			std::lock_guard<std::mutex> flushLock(flushMutex);
+			flushRunning = false;
+		}
+		flushCv.notify_one();
+		flushThread.join();
+	}
+
+	std::lock_guard<std::timed_mutex> lock(mutex);
+	drainRings();
 	if (outputFile && outputFile != stderr) {
 		// Print end token so we know if the logger exited cleanly.
 		std::fprintf(outputFile, "END");
@@ -98,17 +311,67 @@ static void logVa(Level level, const char* filename, int line, const char* func,
 	if (!outputFile)
 		return;
 	double nowTime = system::getTime();
-	std::lock_guard<std::mutex> lock(mutex);
-
-	if (outputFile == stderr)
-		std::fprintf(outputFile, "\x1B[%dm", levelColors[level]);
-	std::fprintf(outputFile, "[%.03f %s %s:%d %s] ", nowTime, levelLabels[level], filename, line, func);
-	if (outputFile == stderr)
-		std::fprintf(outputFile, "\x1B[0m");
-	std::vfprintf(outputFile, format, args);
-	std::fprintf(outputFile, "\n");
-	// Note: This adds around 10us, but it's important for logging to finish writing the file, and logging is not used in performance critical code.
-	std::fflush(outputFile);
+
+	// Format the entire line on this thread, without holding any lock
+	char buf[1024];
+	std::string str;
+	const char* text = buf;
+	size_t size = 0;
+	{
+		int n = 0;
+		if (outputFile == stderr)
+			n = std::snprintf(buf, sizeof(buf), "\x1B[%dm[%.03f %s %s:%d %s] \x1B[0m", levelColors[level], nowTime, levelLabels[level], filename, line, func);
+		else
+			n = std::snprintf(buf, sizeof(buf), "[%.03f %s %s:%d %s] ", nowTime, levelLabels[level], filename, line, func);
+		size_t prefixSize = std::min<size_t>(std::max(n, 0), sizeof(buf) - 1);
+
+		va_list argsCopy;
+		va_copy(argsCopy, args);
+		int m = std::vsnprintf(buf + prefixSize, sizeof(buf) - prefixSize, format, argsCopy);
+		va_end(argsCopy);
+		m = std::max(m, 0);
+
+		if (prefixSize + m + 1 < sizeof(buf)) {
+			buf[prefixSize + m] = '\n';
+			size = prefixSize + m + 1;
+		}
+		else {
+			// Line doesn't fit in the stack buffer
+			str.assign(buf, prefixSize);
+			str.resize(prefixSize + m + 1);
+			std::vsnprintf(&str[prefixSize], m + 1, format, args);
+			str[prefixSize + m] = '\n';
+			text = str.data();
+			size = str.size();
+		}
+	}
+
+	if (level == FATAL_LEVEL) {
+		// Write immediately since the process might be about to die.
+		// Don't wait forever in case we crashed while holding the lock.
+		std::unique_lock<std::timed_mutex> lock(mutex, std::defer_lock);
+		bool locked = lock.try_lock_for(std::chrono::seconds(1));
+		if (locked)
+			drainRings();
+		std::fwrite(text, 1, size, outputFile);
+		std::fflush(outputFile);
+		return;
+	}
+
+	Ring* ring = threadRing.ring.load(std::memory_order_acquire);
+	if (ring && ring->push(nowTime, text, size))
+		return;
+
+	// The thread has no ring yet or it is full, so write on this thread after earlier lines.
+	std::lock_guard<std::timed_mutex> lock(mutex);
+	drainRings();
+	if (!ring)
+		requestThreadRing();
+	if (!ring || !ring->push(nowTime, text, size)) {
+		// No ring, or line is larger than the ring
+		std::fwrite(text, 1, size, outputFile);
+		std::fflush(outputFile);
+	}
 }
 
 void log(Level level, const char* filename, int line, const char* func, const char* format, ...) {
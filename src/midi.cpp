@@ -9,6 +9,7 @@
 #include <system.hpp>
 #include <context.hpp>
 #include <engine/Engine.hpp>
+#include <rcu.hpp>
 
 
 namespace rack {
@@ -17,6 +18,14 @@ namespace midi {
 
 static std::vector<std::pair<int, Driver*>> drivers;
 
+/** Copy of each InputDevice's `subscribed` set that driver threads iterate without locking.
+Kept outside of InputDevice so its layout stays compatible with plugins compiled against earlier headers.
+unsubscribe() waits until onMessage() no longer uses the Input, so the Input can be destroyed afterward.
+*/
+static RcuListMap<const InputDevice*, Input*> deviceInputs;
+/** Serializes changes to the `subscribed` sets of InputDevices. */
+static std::mutex inputSubscribeMutex;
+
 std::string Message::toString() const {
 	std::string s;
 	for (size_t i = 0; i < bytes.size(); i++) {
@@ -39,18 +48,52 @@ std::string Message::toString() const {
 ////////////////////
 
 void InputDevice::subscribe(Input* input) {
+	std::lock_guard<std::mutex> lock(inputSubscribeMutex);
 	subscribed.insert(input);
+	deviceInputs.set(this, std::vector<Input*>(subscribed.begin(), subscribed.end()));
 }
 
 void InputDevice::unsubscribe(Input* input) {
 	// Remove Input from subscriptions
+	std::lock_guard<std::mutex> lock(inputSubscribeMutex);
 	auto it = subscribed.find(input);
 	if (it != subscribed.end())
 		subscribed.erase(it);
+	deviceInputs.set(this, std::vector<Input*>(subscribed.begin(), subscribed.end()));
+}
+
+double ClockTracker::process(double deltaTime, double systemTime) {
+	if (!std::isfinite(deltaTime) || deltaTime < 0.0 || deltaTime > MAX_GAP)
+		reset();
+	else
+		driverTime += deltaTime;
+
+	double observedOffset = systemTime - driverTime;
+	if (!std::isfinite(offset) || observedOffset < offset) {
+		offset = observedOffset;
+	}
+	else {
+		offset = std::min(observedOffset, offset + (systemTime - lastSystemTime) * MAX_DRIFT);
+	}
+	lastSystemTime = systemTime;
+	return std::min(driverTime + offset, systemTime);
+}
+
+
+void ClockTracker::reset() {
+	driverTime = 0.0;
+	offset = NAN;
 }
 
+
 void InputDevice::onMessage(const Message& message) {
-	for (Input* input : subscribed) {
+	onMessage(message, system::getTime());
+}
+
+void InputDevice::onMessage(const Message& message, double time) {
+	// Don't lock, since this is called by the driver thread.
+	RcuListMap<const InputDevice*, Input*>::Reader inputs(deviceInputs, this);
+	for (Input* input : inputs) {
 		// Filter channel if message is not a system MIDI message
 		if (message.getStatus() != 0xf && input->channel >= 0 && message.getChannel() != input->channel)
 			continue;
@@ -58,10 +101,10 @@ void InputDevice::onMessage(const Message& message) {
 		// We're probably in the MIDI driver's thread, so set the Rack context.
 		contextSet(input->context);
 
-		// Set timestamp to now if unset
+		// Set timestamp from the arrival time if unset
 		if (message.getFrame() < 0) {
 			Message msg = message;
-			double deltaTime = system::getTime() - APP->engine->getBlockTime();
+			double deltaTime = time - APP->engine->getBlockTime();
 			int64_t deltaFrames = std::floor(deltaTime * APP->engine->getSampleRate());
 			// Delay message by current Engine block size
 			deltaFrames += APP->engine->getBlockFrames();
@@ -0,0 +1,304 @@
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cmath>
+#if defined ARCH_LIN
+	#include <linux/futex.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+	#include <time.h>
+#endif
+#if defined ARCH_MAC
+	#include <dispatch/dispatch.h>
+#endif
+#if defined ARCH_WIN
+	#include <windows.h>
+#endif
+
+#include <mutex.hpp>
+#include <math.hpp>
+
+
+namespace rack {
+
+
+static const int ARRIVAL_FANIN = 4;
+static const int WAKEUP_FANOUT = 2;
+/** Bounds of the number of pause instructions to spin before parking */
+static const int SPIN_LIMIT_MIN = 1 << 6;
+static const int SPIN_LIMIT_MAX = 1 << 14;
+
+
+/** State of one participating thread */
+struct BarrierNode {
+	/** Number of children in the arrival tree that reached the current phase */
+	std::atomic<uint32_t> arrived{0};
+	/** Phase this thread has been released from, written by its parent in the wakeup tree */
+	std::atomic<uint32_t> released{0};
+	/** Set while the thread is parked, so wakers can skip the system call otherwise */
+	std::atomic<bool> parked{false};
+
+	// Only accessed by the owning thread
+	uint32_t phase = 0;
+	int spinLimit = SPIN_LIMIT_MIN;
+
+#if !defined ARCH_LIN
+	std::mutex mutex;
+	std::condition_variable cv;
+#endif
+
+	/** Keeps the atomics of neighboring nodes in separate cache line pairs.
+	Padding is used instead of alignas() since `new[]` doesn't support over-aligned types before C++17.
+	*/
+	uint8_t padding[128];
+
+	/** Blocks until `word` equals `value`. */
+	void park(std::atomic<uint32_t>& word, uint32_t value) {
+		parked.store(true);
+#if defined ARCH_LIN
+		static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "");
+		while (true) {
+			uint32_t v = word.load();
+			if (v == value)
+				break;
+			// Returns immediately if `word` has changed since it was loaded, so wakeups can't be lost.
+			syscall(SYS_futex, (uint32_t*) &word, FUTEX_WAIT_PRIVATE, v, NULL, NULL, 0);
+		}
+#else
+		std::unique_lock<std::mutex> lock(mutex);
+		cv.wait(lock, [&]() {
+			return word.load() == value;
+		});
+#endif
+		parked.store(false, std::memory_order_relaxed);
+	}
+
+	/** Wakes the thread if it is parked on `word`.
+	Must be called after changing `word`.
+	*/
+	void unpark(std::atomic<uint32_t>& word) {
+		if (!parked.load())
+			return;
+#if defined ARCH_LIN
+		// Each word has at most one waiter, the owning thread.
+		syscall(SYS_futex, (uint32_t*) &word, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#else
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+		}
+		cv.notify_one();
+#endif
+	}
+};
+
+
+struct Barrier::Internal {
+	int threads = 0;
+	std::unique_ptr<BarrierNode[]> nodes;
+	std::atomic<bool> yielded{false};
+
+	int getArrivalChildren(int id) {
+		return math::clamp(threads - (ARRIVAL_FANIN * id + 1), 0, ARRIVAL_FANIN);
+	}
+
+	/** Waits until `word` equals `value`, first by spinning and then by parking. */
+	void waitFor(BarrierNode& node, std::atomic<uint32_t>& word, uint32_t value) {
+		int spinLimit = yielded.load(std::memory_order_relaxed) ? 0 : node.spinLimit;
+		for (int i = 0; i < spinLimit; i++) {
+			if (word.load(std::memory_order_acquire) == value) {
+				// Allow spinning up to twice as long as this wait took
+				node.spinLimit = math::clamp(2 * i, node.spinLimit, SPIN_LIMIT_MAX);
+				return;
+			}
+			if (yielded.load(std::memory_order_relaxed))
+				break;
+#if defined ARCH_X64
+			__builtin_ia32_pause();
+#endif
+		}
+		if (word.load(std::memory_order_acquire) == value)
+			return;
+		// Spinning didn't pay off, so give up sooner next time
+		node.spinLimit = std::max(node.spinLimit / 2, SPIN_LIMIT_MIN);
+		node.park(word, value);
+	}
+};
+
+
+Barrier::Barrier() {
+	internal = new Internal;
+}
+
+
+Barrier::~Barrier() {
+	delete internal;
+}
+
+
+void Barrier::setThreads(int threads) {
+	internal->threads = threads;
+	internal->nodes.reset(threads > 0 ? new BarrierNode[threads] : NULL);
+	internal->yielded = false;
+}
+
+
+int Barrier::getThreads() {
+	return internal->threads;
+}
+
+
+void Barrier::wait(int threadId) {
+	assert(0 <= threadId && threadId < internal->threads);
+	BarrierNode* nodes = internal->nodes.get();
+	BarrierNode& node = nodes[threadId];
+	uint32_t phase = ++node.phase;
+
+	// Wait for children to arrive
+	int children = internal->getArrivalChildren(threadId);
+	if (children > 0) {
+		internal->waitFor(node, node.arrived, children);
+		// Children can't arrive again until they are released below, so the counter can be reset without racing them.
+		node.arrived.store(0, std::memory_order_relaxed);
+	}
+
+	if (threadId > 0) {
+		// Arrive at parent, waking it if we're its last child
+		int parentId = (threadId - 1) / ARRIVAL_FANIN;
+		BarrierNode& parent = nodes[parentId];
+		if ((int) parent.arrived.fetch_add(1) + 1 == internal->getArrivalChildren(parentId))
+			parent.unpark(parent.arrived);
+
+		// Wait for release
+		internal->waitFor(node, node.released, phase);
+	}
+	else {
+		// All threads have arrived, so the phase is complete.
+		internal->yielded.store(false, std::memory_order_relaxed);
+	}
+
+	// Release children
+	for (int i = 1; i <= WAKEUP_FANOUT; i++) {
+		int childId = WAKEUP_FANOUT * threadId + i;
+		if (childId >= internal->threads)
+			break;
+		BarrierNode& child = nodes[childId];
+		child.released.store(phase);
+		child.unpark(child.released);
+	}
+}
+
+
+void Barrier::yield() {
+	internal->yielded = true;
+}
+
+
+struct Semaphore::Internal {
+#if defined ARCH_LIN
+	std::atomic<uint32_t> count{0};
+	/** Number of threads in or about to enter FUTEX_WAIT, so post() can skip the system call otherwise */
+	std::atomic<uint32_t> waiters{0};
+
+	bool tryDecrement() {
+		uint32_t c = count.load();
+		while (c > 0) {
+			if (count.compare_exchange_weak(c, c - 1))
+				return true;
+		}
+		return false;
+	}
+
+	/** Waits until the count is decremented or `duration` seconds have passed. `duration` may be infinite. */
+	bool wait(double duration) {
+		auto start = std::chrono::steady_clock::now();
+		while (!tryDecrement()) {
+			struct timespec timeout;
+			struct timespec* timeoutPtr = NULL;
+			if (std::isfinite(duration)) {
+				double remaining = duration - std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				if (remaining <= 0.0)
+					return false;
+				timeout.tv_sec = (time_t) remaining;
+				timeout.tv_nsec = (long) ((remaining - timeout.tv_sec) * 1e9);
+				timeoutPtr = &timeout;
+			}
+			waiters.fetch_add(1);
+			// Returns immediately if a post() has already made the count nonzero.
+			syscall(SYS_futex, (uint32_t*) &count, FUTEX_WAIT_PRIVATE, 0, timeoutPtr, NULL, 0);
+			waiters.fetch_sub(1);
+		}
+		return true;
+	}
+#elif defined ARCH_MAC
+	dispatch_semaphore_t semaphore;
+#elif defined ARCH_WIN
+	HANDLE semaphore;
+#endif
+};
+
+
+Semaphore::Semaphore() {
+	internal = new Internal;
+#if defined ARCH_MAC
+	internal->semaphore = dispatch_semaphore_create(0);
+	if (!internal->semaphore)
+		throw Exception("dispatch_semaphore_create failed");
+#elif defined ARCH_WIN
+	internal->semaphore = CreateSemaphoreW(NULL, 0, LONG_MAX, NULL);
+	if (!internal->semaphore)
+		throw Exception("CreateSemaphore failed");
+#endif
+}
+
+
+Semaphore::~Semaphore() {
+#if defined ARCH_MAC
+	dispatch_release(internal->semaphore);
+#elif defined ARCH_WIN
+	CloseHandle(internal->semaphore);
+#endif
+	delete internal;
+}
+
+
+void Semaphore::post() {
+#if defined ARCH_LIN
+	internal->count.fetch_add(1);
+	if (internal->waiters.load() > 0)
+		syscall(SYS_futex, (uint32_t*) &internal->count, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#elif defined ARCH_MAC
+	dispatch_semaphore_signal(internal->semaphore);
+#elif defined ARCH_WIN
+	ReleaseSemaphore(internal->semaphore, 1, NULL);
+#endif
+}
+
+
+void Semaphore::wait() {
+#if defined ARCH_LIN
+	internal->wait(INFINITY);
+#elif defined ARCH_MAC
+	dispatch_semaphore_wait(internal->semaphore, DISPATCH_TIME_FOREVER);
+#elif defined ARCH_WIN
+	WaitForSingleObject(internal->semaphore, INFINITE);
+#endif
+}
+
+
+bool Semaphore::waitFor(double duration) {
+#if defined ARCH_LIN
+	return internal->wait(duration);
+#elif defined ARCH_MAC
+	dispatch_time_t timeout = dispatch_time(DISPATCH_TIME_NOW, (int64_t) (std::fmax(duration, 0.0) * 1e9));
+	return dispatch_semaphore_wait(internal->semaphore, timeout) == 0;
+#elif defined ARCH_WIN
+	// Round up so short waits don't return early and spin
+	DWORD ms = (DWORD) std::ceil(std::fmax(duration, 0.0) * 1e3);
+	return WaitForSingleObject(internal->semaphore, ms) == WAIT_OBJECT_0;
+#endif
+}
+
+
+} // namespace rack
@@ -1,5 +1,7 @@
 #include <algorithm>
 #include <fstream>
+#include <set>
+#include <map>
 
 #include <osdialog.h>
 
@@ -13,6 +15,9 @@
 #include <app/RackWidget.hpp>
 #include <history.hpp>
 #include <settings.hpp>
+#include <trace.hpp>
+#include <plugin.hpp>
+#include <window/Svg.hpp>
 
 
 namespace rack {
@@ -22,7 +27,93 @@ namespace patch {
 static const char PATCH_FILTERS[] = "VCV Rack patch (.vcv):vcv";
 
 
+struct ModelSvgs {
+	/** Plugin version that loaded the SVGs, since another version might load different files */
+	std::string version;
+	std::set<std::string> filenames;
+};
+
+
+struct Manager::Internal {
+	/** SVGs loaded by each Model's ModuleWidget, keyed by "pluginSlug/modelSlug".
+	Persisted in the user folder, so the first patch loaded at launch can also preload them.
+	*/
+	std::map<std::string, ModelSvgs> modelSvgs;
+	std::string modelSvgsPath;
+	bool modelSvgsLoaded = false;
+	bool modelSvgsChanged = false;
+
+	void loadModelSvgs() {
+		if (modelSvgsLoaded)
+			return;
+		modelSvgsLoaded = true;
+
+		FILE* file = std::fopen(modelSvgsPath.c_str(), "r");
+		if (!file)
+			return;
+		DEFER({std::fclose(file);});
+
+		json_error_t error;
+		json_t* rootJ = json_loadf(file, 0, &error);
+		if (!rootJ) {
+			WARN("SVG list %s has invalid JSON at %d:%d %s", modelSvgsPath.c_str(), error.line, error.column, error.text);
+			return;
+		}
+		DEFER({json_decref(rootJ);});
+
+		const char* key;
+		json_t* modelJ;
+		json_object_foreach(rootJ, key, modelJ) {
+			ModelSvgs& ms = modelSvgs[key];
+			json_t* versionJ = json_object_get(modelJ, "version");
+			if (versionJ)
+				ms.version = json_string_value(versionJ);
+			json_t* svgsJ = json_object_get(modelJ, "svgs");
+			size_t i;
+			json_t* svgJ;
+			json_array_foreach(svgsJ, i, svgJ) {
+				ms.filenames.insert(json_string_value(svgJ));
+			}
+		}
+	}
+
+	void saveModelSvgs() {
+		if (!modelSvgsChanged)
+			return;
+
+		json_t* rootJ = json_object();
+		DEFER({json_decref(rootJ);});
+		for (const auto& pair : modelSvgs) {
+			json_t* modelJ = json_object();
+			json_object_set_new(modelJ, "version", json_string(pair.second.version.c_str()));
+			json_t* svgsJ = json_array();
+			for (const std::string& filename : pair.second.filenames) {
+				json_array_append_new(svgsJ, json_string(filename.c_str()));
+			}
+			json_object_set_new(modelJ, "svgs", svgsJ);
+			json_object_set_new(rootJ, pair.first.c_str(), modelJ);
+		}
+
+		std::string tmpPath = modelSvgsPath + ".tmp";
+		FILE* file = std::fopen(tmpPath.c_str(), "w");
+		if (!file)
+			return;
+		json_dumpf(rootJ, file, 0);
+		std::fclose(file);
+		system::remove(modelSvgsPath);
+		system::rename(tmpPath, modelSvgsPath);
+	}
+};
+
+
+static std::string getModelKey(plugin::Model* model) {
+	return model->plugin->slug + "/" + model->slug;
+}
+
+
 Manager::Manager() {
+	internal = new Internal;
+	internal->modelSvgsPath = asset::user("svgs.json");
 	autosavePath = asset::user("autosave");
 
 	// Use a different temporary autosave dir when safe mode is enabled, to avoid altering normal autosave.
@@ -37,12 +128,18 @@ Manager::Manager() {
 
 
 Manager::~Manager() {
+	DEFER({delete internal;});
+
 	// In safe mode, delete autosave dir.
 	if (settings::safeMode) {
 		clearAutosave();
 		return;
 	}
 
+	if (!settings::headless) {
+		internal->saveModelSvgs();
+	}
+
 	// Dispatch onSave to all Modules so they save their patch storage, etc.
 	APP->engine->prepareSave();
 	// Save autosave if not headless
@@ -104,6 +201,7 @@ static bool promptClear(std::string text) {
 
 
 void Manager::save(std::string path) {
+	TRACE_SCOPE("patch::Manager::save");
 	INFO("Saving patch %s", path.c_str());
 	// Dispatch SaveEvent to modules
 	APP->engine->prepareSave();
@@ -270,6 +368,7 @@ static bool isPatchLegacyV1(std::string path) {
 
 
 void Manager::load(std::string path) {
+	TRACE_SCOPE("patch::Manager::load");
 	INFO("Loading patch %s", path.c_str());
 
 	clear();
@@ -473,7 +572,46 @@ json_t* Manager::toJson() {
 }
 
 
+/** Parses the SVGs that the patch's ModuleWidgets loaded the last time they were created, in parallel, before the ModuleWidgets load them one at a time on the UI thread. */
+static void preloadSvgs(Manager::Internal* internal, json_t* rootJ) {
+	internal->loadModelSvgs();
+
+	std::set<std::string> filenameSet;
+	json_t* modulesJ = json_object_get(rootJ, "modules");
+	size_t moduleIndex;
+	json_t* moduleJ;
+	json_array_foreach(modulesJ, moduleIndex, moduleJ) {
+		json_t* pluginJ = json_object_get(moduleJ, "plugin");
+		json_t* modelJ = json_object_get(moduleJ, "model");
+		if (!pluginJ || !modelJ)
+			continue;
+		plugin::Model* model = plugin::getModelFallback(json_string_value(pluginJ), json_string_value(modelJ));
+		if (!model)
+			continue;
+		auto it = internal->modelSvgs.find(getModelKey(model));
+		if (it == internal->modelSvgs.end() || it->second.version != model->plugin->version)
+			continue;
+		filenameSet.insert(it->second.filenames.begin(), it->second.filenames.end());
+	}
+
+	std::vector<std::string> filenames;
+	for (const std::string& filename : filenameSet) {
+		// Skip files removed since they were recorded, rather than logging a failure for each
+		if (system::isFile(filename))
+			filenames.push_back(filename);
+	}
+	if (filenames.empty())
+		return;
+
+	double startTime = system::getTime();
+	window::Svg::preload(filenames);
+	double endTime = system::getTime();
+	INFO("Preloaded %d SVGs in %lf seconds", (int) filenames.size(), (endTime - startTime));
+}
+
+
 void Manager::fromJson(json_t* rootJ) {
+	TRACE_SCOPE("patch::Manager::fromJson");
 	clear();
 	warningLog = "";
 
@@ -513,6 +651,10 @@ void Manager::fromJson(json_t* rootJ) {
 		}
 	}
 
+	if (APP->scene) {
+		preloadSvgs(internal, rootJ);
+	}
+
 	// Pass JSON to Engine and RackWidget
 	try {
 		APP->engine->fromJson(rootJ);
@@ -535,6 +677,17 @@ void Manager::fromJson(json_t* rootJ) {
 }
 
 
+void Manager::setModelSvgs(plugin::Model* model, const std::set<std::string>& filenames) {
+	internal->loadModelSvgs();
+	ModelSvgs& ms = internal->modelSvgs[getModelKey(model)];
+	if (ms.version == model->plugin->version && ms.filenames == filenames)
+		return;
+	ms.version = model->plugin->version;
+	ms.filenames = filenames;
+	internal->modelSvgsChanged = true;
+}
+
+
 void Manager::log(std::string msg) {
 	warningLog += msg;
 	warningLog += "\n";
@@ -26,6 +26,7 @@
 #include <context.hpp>
 #include <plugin/callbacks.hpp>
 #include <settings.hpp>
+#include <trace.hpp>
 
 
 namespace rack {
@@ -124,6 +125,7 @@ static InitCallback loadPluginCallback(Plugin* plugin) {
 
 /** If path is blank, loads Core */
 static Plugin* loadPlugin(std::string path) {
+	TRACE_SCOPE("plugin::loadPlugin");
 	if (path == "")
 		INFO("Loading Core plugin");
 	else
@@ -247,6 +249,7 @@ static void extractPackages(std::string path) {
 ////////////////////
 
 void init() {
+	TRACE_SCOPE("plugin::init");
 	// Don't re-initialize
 	assert(plugins.empty());
 
@@ -1,3 +1,6 @@
+#include <atomic>
+#include <mutex>
+
 #include <random.hpp>
 #include <math.hpp>
 #include <system.hpp>
@@ -7,28 +10,63 @@ namespace rack {
 namespace random {
 
 
-static Xoroshiro128Plus rng;
+/** Generator from which each thread's generator is copied before jumping it to the next stream */
+static Xoroshiro128Plus masterRng;
+static std::mutex masterMutex;
+/** Incremented by seed() so threads know to reseed */
+static std::atomic<uint32_t> masterGeneration{1};
+
+static thread_local Xoroshiro128Plus rng;
+static thread_local uint32_t rngGeneration = 0;
+
+
+static uint64_t splitmix64(uint64_t& x) {
+	uint64_t z = (x += 0x9e3779b97f4a7c15);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+	return z ^ (z >> 31);
+}
+
+
+static void seedMaster(uint64_t s) {
+	// Spread the bits of the seed across both state words, since seeds are often small integers or timestamps.
+	uint64_t s0 = splitmix64(s);
+	uint64_t s1 = splitmix64(s);
+	masterRng.seed(s0, s1);
+}
 
 
 void init() {
+	uint32_t generation = masterGeneration.load(std::memory_order_acquire);
 	// Don't reset state if already seeded
-	if (rng.isSeeded())
+	if (rngGeneration == generation)
 		return;
 
-	// Get epoch time for seed
-	double time = system::getUnixTime();
-	uint64_t sec = time;
-	uint64_t nsec = std::fmod(time, 1.0) * 1e9;
-	rng.seed(sec, nsec);
-
-	// Shift state a few times due to low seed entropy
-	for (int i = 0; i < 4; i++) {
-		rng();
+	std::lock_guard<std::mutex> lock(masterMutex);
+	if (!masterRng.isSeeded()) {
+		// Get epoch time for seed
+		double time = system::getUnixTime();
+		uint64_t sec = time;
+		uint64_t nsec = std::fmod(time, 1.0) * 1e9;
+		seedMaster(sec * 1000000000 + nsec);
 	}
+	rng = masterRng;
+	masterRng.jump();
+	rngGeneration = masterGeneration.load(std::memory_order_relaxed);
+}
+
+
+void seed(uint64_t s) {
+	std::lock_guard<std::mutex> lock(masterMutex);
+	seedMaster(s);
+	masterGeneration++;
 }
 
 
 Xoroshiro128Plus& local() {
+	// Threads that never called init() still get their own stream.
+	if (!rng.isSeeded())
+		init();
 	return rng;
 }
 
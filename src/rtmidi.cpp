@@ -4,6 +4,9 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstring>
 
 #pragma GCC diagnostic push
 #ifndef __clang__
@@ -16,6 +19,7 @@
 #include <midi.hpp>
 #include <string.hpp>
 #include <system.hpp>
+#include <mutex.hpp>
 #include <context.hpp>
 #include <engine/Engine.hpp>
 
@@ -31,6 +35,8 @@ static void rtMidiErrorCallback(RtMidiError::Type type, const std::string& error
 struct RtMidiInputDevice : midi::InputDevice {
 	RtMidiIn* rtMidiIn;
 	std::string name;
+	/** Only accessed by the driver's callback thread */
+	midi::ClockTracker clockTracker;
 
 	RtMidiInputDevice(int driverId, int deviceId) {
 		try {
@@ -78,10 +84,85 @@ struct RtMidiInputDevice : midi::InputDevice {
 		if (!that)
 			return;
 
+		double time = that->clockTracker.process(timeStamp, system::getTime());
+
 		midi::Message msg;
 		msg.bytes = std::vector<uint8_t>(message->begin(), message->end());
-		// Don't set msg.frame from timeStamp here, because it's set in onMessage().
-		that->onMessage(msg);
+		// Don't set msg.frame here, because it's set from the time in onMessage().
+		that->onMessage(msg, time);
+	}
+};
+
+
+/** Bounded lock-free multi-producer single-consumer queue of scheduled MIDI messages.
+Several engine threads can send to the same output device, so a single-producer queue isn't enough.
+Based on Dmitry Vyukov's bounded MPMC queue.
+Messages are stored inline to avoid allocating on the engine thread.
+*/
+struct MessageQueue {
+	/** Longer messages (SysEx) are handled by the caller. */
+	static constexpr size_t MAX_SIZE = 8;
+	static constexpr size_t CAPACITY = 1024;
+
+	struct Slot {
+		std::atomic<size_t> sequence;
+		double timestamp;
+		uint8_t size;
+		uint8_t bytes[MAX_SIZE];
+	};
+	Slot slots[CAPACITY];
+	std::atomic<size_t> enqueuePos{0};
+	std::atomic<size_t> dequeuePos{0};
+
+	MessageQueue() {
+		for (size_t i = 0; i < CAPACITY; i++)
+			slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	/** Returns false if the queue is full. Callable from any thread. */
+	bool push(const midi::Message& message, double timestamp) {
+		assert(message.bytes.size() <= MAX_SIZE);
+		size_t pos = enqueuePos.load(std::memory_order_relaxed);
+		Slot* slot;
+		while (true) {
+			slot = &slots[pos % CAPACITY];
+			size_t seq = slot->sequence.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+			if (diff == 0) {
+				if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0) {
+				return false;
+			}
+			else {
+				pos = enqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+		slot->timestamp = timestamp;
+		slot->size = message.bytes.size();
+		std::memcpy(slot->bytes, message.bytes.data(), slot->size);
+		slot->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	/** Returns false if the queue is empty. Only callable from the consumer thread. */
+	bool shift(midi::Message& message, double& timestamp) {
+		size_t pos = dequeuePos.load(std::memory_order_relaxed);
+		Slot* slot = &slots[pos % CAPACITY];
+		size_t seq = slot->sequence.load(std::memory_order_acquire);
+		if ((intptr_t) seq - (intptr_t) (pos + 1) < 0)
+			return false;
+		dequeuePos.store(pos + 1, std::memory_order_relaxed);
+		timestamp = slot->timestamp;
+		message.bytes.assign(slot->bytes, slot->bytes + slot->size);
+		slot->sequence.store(pos + CAPACITY, std::memory_order_release);
+		return true;
+	}
+
+	/** Approximate number of queued messages */
+	size_t size() {
+		return enqueuePos.load(std::memory_order_relaxed) - dequeuePos.load(std::memory_order_relaxed);
 	}
 };
 
@@ -98,12 +179,29 @@ struct RtMidiOutputDevice : midi::OutputDevice {
 			return timestamp > other.timestamp;
 		}
 	};
-	std::priority_queue<MessageSchedule, std::vector<MessageSchedule>> messageQueue;
+	/** Pushed by engine threads, drained by the output thread. */
+	MessageQueue messageQueue;
+	/** Messages too long for `messageQueue`, or that didn't fit in it. Rare, so a mutex is fine. */
+	std::vector<MessageSchedule> overflowQueue;
+	std::mutex overflowMutex;
+	/** Owned by the output thread */
+	std::priority_queue<MessageSchedule, std::vector<MessageSchedule>> schedule;
 
 	std::thread thread;
-	std::mutex mutex;
-	std::condition_variable cv;
-	bool stopped = false;
+	/** Posted by producers to wake the output thread. Posting never blocks, so wakeups can't be lost. */
+	Semaphore semaphore;
+	/** Set by the output thread before it waits on `semaphore`, so producers only post when needed. */
+	std::atomic<bool> waiting{false};
+	std::atomic<bool> stopped{false};
+
+	/** Statistics, owned by the output thread */
+	struct Stats {
+		int64_t messages = 0;
+		size_t maxQueueSize = 0;
+		double jitterSum = 0.0;
+		double maxJitter = 0.0;
+	};
+	Stats stats;
 
 	RtMidiOutputDevice(int driverId, int deviceId) {
 		try {
@@ -133,6 +231,9 @@ struct RtMidiOutputDevice : midi::OutputDevice {
 
 	~RtMidiOutputDevice() {
 		stopThread();
+		if (stats.messages > 0) {
+			INFO("MIDI output %s sent %lld scheduled messages, max queue size %d, mean jitter %.3f ms, max jitter %.3f ms", name.c_str(), (long long) stats.messages, (int) stats.maxQueueSize, stats.jitterSum / stats.messages * 1e3, stats.maxJitter * 1e3);
+		}
 		// This does not throw for any driver API
 		rtMidiOut->closePort();
 		delete rtMidiOut;
@@ -149,18 +250,24 @@ struct RtMidiOutputDevice : midi::OutputDevice {
 			return;
 		}
 		// Schedule message to be sent by worker thread
-		MessageSchedule ms;
-		ms.message = message;
 		int64_t deltaFrames = message.getFrame() - APP->engine->getBlockFrame();
 		// Delay message by current Engine block size
 		deltaFrames += APP->engine->getBlockFrames();
 		// Compute time in next Engine block to send message
 		double deltaTime = deltaFrames * APP->engine->getSampleTime();
-		ms.timestamp = APP->engine->getBlockTime() + deltaTime;
+		double timestamp = APP->engine->getBlockTime() + deltaTime;
+
+		if (message.bytes.size() > MessageQueue::MAX_SIZE || !messageQueue.push(message, timestamp)) {
+			MessageSchedule ms;
+			ms.message = message;
+			ms.timestamp = timestamp;
+			std::lock_guard<std::mutex> lock(overflowMutex);
+			overflowQueue.push_back(ms);
+		}
 
-		std::lock_guard<decltype(mutex)> lock(mutex);
-		messageQueue.push(ms);
-		cv.notify_one();
+		// Wake the output thread only if it's idle or waiting for a later message.
+		if (waiting.exchange(false))
+			semaphore.post();
 	}
 
 	// Consumer thread methods
@@ -169,34 +276,71 @@ struct RtMidiOutputDevice : midi::OutputDevice {
 		thread = std::thread(&RtMidiOutputDevice::runThread, this);
 	}
 
+	/** Moves messages from the producer queues to the schedule. */
+	void pullMessages() {
+		stats.maxQueueSize = std::max(stats.maxQueueSize, messageQueue.size());
+
+		MessageSchedule queued;
+		while (messageQueue.shift(queued.message, queued.timestamp)) {
+			schedule.push(queued);
+		}
+
+		std::lock_guard<std::mutex> lock(overflowMutex);
+		for (const MessageSchedule& ms : overflowQueue) {
+			schedule.push(ms);
+		}
+		overflowQueue.clear();
+	}
+
 	void runThread() {
 		system::setThreadName("RtMidi output");
 
-		std::unique_lock<decltype(mutex)> lock(mutex);
 		while (!stopped) {
-			if (messageQueue.empty()) {
-				// No messages. Wait on the CV to be notified.
-				cv.wait(lock);
-			}
-			else {
-				// Get earliest message
-				const MessageSchedule& ms = messageQueue.top();
-				double duration = ms.timestamp - system::getTime();
-
-				// If we need to wait, release the lock and wait for the timeout, or if the CV is notified.
-				// This correctly handles MIDI messages with no timestamp, because duration will be NAN.
-				if (duration > 0) {
-					if (cv.wait_for(lock, std::chrono::duration<double>(duration)) != std::cv_status::timeout)
-						continue;
-				}
+			pullMessages();
 
-				// Send and remove from queue
+			// Send all messages that are due
+			double now = system::getTime();
+			// This correctly handles MIDI messages with no timestamp, because the comparison with NAN is false.
+			while (!schedule.empty() && !(schedule.top().timestamp > now)) {
+				const MessageSchedule& ms = schedule.top();
 				sendMessageNow(ms.message);
-				messageQueue.pop();
+				if (std::isfinite(ms.timestamp)) {
+					double jitter = system::getTime() - ms.timestamp;
+					stats.messages++;
+					stats.jitterSum += jitter;
+					stats.maxJitter = std::max(stats.maxJitter, jitter);
+				}
+				schedule.pop();
+			}
+
+			// Wait until the next message is due, or until a producer pushes a message.
+			// Set `waiting` before checking the queues, so a producer that pushes after the check posts the semaphore.
+			waiting = true;
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (stopped || !isQueueEmpty()) {
+				waiting = false;
+				continue;
+			}
+			if (schedule.empty()) {
+				semaphore.wait();
 			}
+			else {
+				double duration = schedule.top().timestamp - system::getTime();
+				if (duration > 0)
+					semaphore.waitFor(duration);
+			}
+			// A producer may have posted after we stopped waiting, which only causes one extra iteration.
+			waiting = false;
 		}
 	}
 
+	bool isQueueEmpty() {
+		if (messageQueue.size() > 0)
+			return false;
+		std::lock_guard<std::mutex> lock(overflowMutex);
+		return overflowQueue.empty();
+	}
+
 	void sendMessageNow(const midi::Message& message) {
 		try {
 			rtMidiOut->sendMessage(message.bytes.data(), message.bytes.size());
@@ -207,11 +351,8 @@ struct RtMidiOutputDevice : midi::OutputDevice {
 	}
 
 	void stopThread() {
-		{
-			std::lock_guard<decltype(mutex)> lock(mutex);
-			stopped = true;
-			cv.notify_one();
-		}
+		stopped = true;
+		semaphore.post();
 		if (thread.joinable())
 			thread.join();
 	}
@@ -50,6 +50,10 @@ bool preferDarkPanels = false;
 #else
 	float frameRateLimit = 60.f;
 #endif
+float idleFrameRateLimit = 10.f;
+float idleTimeout = 10.f;
+float backgroundFrameRateLimit = 0.f;
+float framebufferBudget = 256.f;
 float autosaveInterval = 15.0;
 bool skipLoadOnLaunch = false;
 std::list<std::string> recentPatchPaths;
@@ -167,6 +171,14 @@ json_t* toJson() {
 
 	json_object_set_new(rootJ, "frameRateLimit", json_real(frameRateLimit));
 
+	json_object_set_new(rootJ, "idleFrameRateLimit", json_real(idleFrameRateLimit));
+
+	json_object_set_new(rootJ, "idleTimeout", json_real(idleTimeout));
+
+	json_object_set_new(rootJ, "backgroundFrameRateLimit", json_real(backgroundFrameRateLimit));
+
+	json_object_set_new(rootJ, "framebufferBudget", json_real(framebufferBudget));
+
 	json_object_set_new(rootJ, "autosaveInterval", json_real(autosaveInterval));
 
 	if (skipLoadOnLaunch)
@@ -377,6 +389,22 @@ void fromJson(json_t* rootJ) {
 	if (frameRateLimitJ)
 		frameRateLimit = json_number_value(frameRateLimitJ);
 
+	json_t* idleFrameRateLimitJ = json_object_get(rootJ, "idleFrameRateLimit");
+	if (idleFrameRateLimitJ)
+		idleFrameRateLimit = json_number_value(idleFrameRateLimitJ);
+
+	json_t* idleTimeoutJ = json_object_get(rootJ, "idleTimeout");
+	if (idleTimeoutJ)
+		idleTimeout = json_number_value(idleTimeoutJ);
+
+	json_t* backgroundFrameRateLimitJ = json_object_get(rootJ, "backgroundFrameRateLimit");
+	if (backgroundFrameRateLimitJ)
+		backgroundFrameRateLimit = json_number_value(backgroundFrameRateLimitJ);
+
+	json_t* framebufferBudgetJ = json_object_get(rootJ, "framebufferBudget");
+	if (framebufferBudgetJ)
+		framebufferBudget = json_number_value(framebufferBudgetJ);
+
 	json_t* autosaveIntervalJ = json_object_get(rootJ, "autosaveInterval");
 	if (autosaveIntervalJ)
 		autosaveInterval = json_number_value(autosaveIntervalJ);
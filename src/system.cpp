@@ -38,6 +38,7 @@
 
 #include <system.hpp>
 #include <string.hpp>
+#include <trace.hpp>
 
 
 /*
@@ -648,6 +649,7 @@ int getLogicalCoreCount() {
 
 
 void setThreadName(const std::string& name) {
+	trace::setThreadName(name);
 #if defined ARCH_LIN
 	pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
 #elif defined ARCH_MAC
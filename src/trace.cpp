@@ -0,0 +1,200 @@
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <thread>
+
+#include <trace.hpp>
+#include <system.hpp>
+#include <string.hpp>
+
+
+namespace rack {
+namespace trace {
+
+
+std::atomic<bool> enabled{false};
+
+
+struct Event {
+	const char* name;
+	int64_t time;
+	/** Duration for spans. Negative for counters. */
+	int64_t duration;
+	double value;
+};
+
+
+/** Events recorded by a single thread */
+struct ThreadBuffer {
+	static constexpr size_t SIZE = 1 << 16;
+	/** Allocated on the first recorded event, so threads that are never traced don't use memory. */
+	std::unique_ptr<Event[]> events;
+	/** Total number of events written. The latest SIZE are kept. */
+	std::atomic<size_t> count{0};
+	/** Set while the owning thread writes an event, so readers can wait for it. */
+	std::atomic<bool> writing{false};
+	int tid = 0;
+	std::string name;
+	std::mutex nameMutex;
+
+	void push(const Event& event) {
+		writing = true;
+		// Tracing might have stopped between the caller's check and setting `writing`.
+		if (enabled) {
+			if (!events)
+				events.reset(new Event[SIZE]);
+			size_t c = count.load(std::memory_order_relaxed);
+			events[c % SIZE] = event;
+			count.store(c + 1, std::memory_order_release);
+		}
+		writing = false;
+	}
+};
+
+
+static std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+static std::mutex buffersMutex;
+static int nextTid = 1;
+
+
+static ThreadBuffer* getThreadBuffer() {
+	static thread_local std::shared_ptr<ThreadBuffer> threadBuffer;
+	if (!threadBuffer) {
+		threadBuffer = std::make_shared<ThreadBuffer>();
+		std::lock_guard<std::mutex> lock(buffersMutex);
+		threadBuffer->tid = nextTid++;
+		buffers.push_back(threadBuffer);
+	}
+	return threadBuffer.get();
+}
+
+
+/** Stops recording and waits until no thread is writing an event. */
+static void stopAndWait() {
+	enabled = false;
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	for (const std::shared_ptr<ThreadBuffer>& buffer : buffers) {
+		while (buffer->writing)
+			std::this_thread::yield();
+	}
+}
+
+
+void start() {
+	stopAndWait();
+	{
+		std::lock_guard<std::mutex> lock(buffersMutex);
+		for (const std::shared_ptr<ThreadBuffer>& buffer : buffers) {
+			buffer->count = 0;
+		}
+	}
+	enabled = true;
+}
+
+
+void stop() {
+	stopAndWait();
+}
+
+
+static std::string escapeJson(const std::string& s) {
+	std::string out;
+	for (char c : s) {
+		if (c == '"' || c == '\\') {
+			out += '\\';
+			out += c;
+		}
+		else if ((unsigned char) c < 0x20) {
+			out += string::f("\\u%04x", c);
+		}
+		else {
+			out += c;
+		}
+	}
+	return out;
+}
+
+
+void save(const std::string& path) {
+	stopAndWait();
+
+	FILE* file = std::fopen(path.c_str(), "w");
+	if (!file)
+		throw Exception("Could not write trace to %s", path.c_str());
+	DEFER({std::fclose(file);});
+
+	std::fprintf(file, "{\"traceEvents\":[\n");
+	bool first = true;
+	auto separator = [&]() {
+		if (!first)
+			std::fprintf(file, ",\n");
+		first = false;
+	};
+
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	for (const std::shared_ptr<ThreadBuffer>& buffer : buffers) {
+		size_t count = buffer->count.load(std::memory_order_acquire);
+		if (count == 0)
+			continue;
+
+		std::string name;
+		{
+			std::lock_guard<std::mutex> nameLock(buffer->nameMutex);
+			name = buffer->name;
+		}
+		if (name.empty())
+			name = string::f("Thread %d", buffer->tid);
+		separator();
+		std::fprintf(file, "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", buffer->tid, escapeJson(name).c_str());
+
+		size_t begin = (count > ThreadBuffer::SIZE) ? (count - ThreadBuffer::SIZE) : 0;
+		for (size_t i = begin; i < count; i++) {
+			const Event& event = buffer->events[i % ThreadBuffer::SIZE];
+			separator();
+			// Timestamps are in microseconds
+			if (event.duration >= 0) {
+				std::fprintf(file, "{\"ph\":\"X\",\"name\":\"%s\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", escapeJson(event.name).c_str(), buffer->tid, event.time / 1e3, event.duration / 1e3);
+			}
+			else {
+				std::fprintf(file, "{\"ph\":\"C\",\"name\":\"%s\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"args\":{\"value\":%g}}", escapeJson(event.name).c_str(), buffer->tid, event.time / 1e3, event.value);
+			}
+		}
+	}
+	std::fprintf(file, "\n]}\n");
+}
+
+
+void setThreadName(const std::string& name) {
+	ThreadBuffer* buffer = getThreadBuffer();
+	std::lock_guard<std::mutex> lock(buffer->nameMutex);
+	buffer->name = name;
+}
+
+
+void recordSpan(const char* name, int64_t startTime, int64_t endTime) {
+	Event event;
+	event.name = name;
+	event.time = startTime;
+	event.duration = endTime - startTime;
+	event.value = 0.0;
+	getThreadBuffer()->push(event);
+}
+
+
+void recordCounter(const char* name, double value) {
+	Event event;
+	event.name = name;
+	event.time = getTime();
+	event.duration = -1;
+	event.value = value;
+	getThreadBuffer()->push(event);
+}
+
+
+int64_t getTime() {
+	return int64_t(system::getTime() * 1e9);
+}
+
+
+} // namespace trace
+} // namespace rack
@@ -1,17 +1,96 @@
+#include <list>
+
 #include <widget/FramebufferWidget.hpp>
 #include <context.hpp>
 #include <random.hpp>
+#include <settings.hpp>
 
 
 namespace rack {
 namespace widget {
 
 
-static int FramebufferWidget_totalPixels = 0;
+static int64_t FramebufferWidget_totalPixels = 0;
+static FramebufferWidget::Stats FramebufferWidget_stats = {};
+
+/** Widgets owning a framebuffer, ordered from least to most recently drawn */
+static std::list<FramebufferWidget*> FramebufferWidget_lru;
+
+
+/** A released framebuffer kept for reuse by a framebuffer of the same size */
+struct PooledFramebuffer {
+	NVGLUframebuffer* fb;
+	int width;
+	int height;
+};
+
+/** Ordered from least to most recently released */
+static std::list<PooledFramebuffer> FramebufferWidget_pool;
+static int64_t FramebufferWidget_poolPixels = 0;
+static const size_t FRAMEBUFFER_POOL_MAX = 32;
+
+/** Number of window frames in which framebuffers were drawn */
+static int64_t FramebufferWidget_frame = 0;
+static double FramebufferWidget_frameTime = NAN;
+
+
+/** Returns the index of the current frame, counting only frames that draw framebuffers. */
+static int64_t getFrame() {
+	double frameTime = APP->window->getFrameTime();
+	if (frameTime != FramebufferWidget_frameTime) {
+		FramebufferWidget_frameTime = frameTime;
+		FramebufferWidget_frame++;
+	}
+	return FramebufferWidget_frame;
+}
+
+
+static void popPool() {
+	PooledFramebuffer& pfb = FramebufferWidget_pool.front();
+	nvgluDeleteFramebuffer(pfb.fb);
+	FramebufferWidget_poolPixels -= (int64_t) pfb.width * pfb.height;
+	FramebufferWidget_pool.pop_front();
+}
+
+
+static void clearPool() {
+	while (!FramebufferWidget_pool.empty()) {
+		popPool();
+	}
+}
+
+
+/** Returns a framebuffer from the pool if one matches, otherwise creates one. */
+static NVGLUframebuffer* acquireFramebuffer(NVGcontext* vg, int width, int height) {
+	for (auto it = FramebufferWidget_pool.begin(); it != FramebufferWidget_pool.end(); ++it) {
+		if (it->fb->ctx == vg && it->width == width && it->height == height) {
+			NVGLUframebuffer* fb = it->fb;
+			FramebufferWidget_poolPixels -= (int64_t) width * height;
+			FramebufferWidget_pool.erase(it);
+			FramebufferWidget_stats.poolHits++;
+			return fb;
+		}
+	}
+
+	FramebufferWidget_stats.poolMisses++;
+	return nvgluCreateFramebuffer(vg, width, height, 0);
+}
+
+
+static void releaseFramebuffer(NVGLUframebuffer* fb, int width, int height) {
+	FramebufferWidget_pool.push_back({fb, width, height});
+	FramebufferWidget_poolPixels += (int64_t) width * height;
+	if (FramebufferWidget_pool.size() > FRAMEBUFFER_POOL_MAX)
+		popPool();
+}
 
 
 struct FramebufferWidget::Internal {
 	NVGLUframebuffer* fb = NULL;
+	/** Position in FramebufferWidget_lru, valid if `fb` is set */
+	std::list<FramebufferWidget*>::iterator lruIt;
+	/** getFrame() of the last frame this framebuffer was drawn */
+	int64_t drawFrame = -1;
 
 	/** Pixel dimensions of the allocated framebuffer */
 	math::Vec fbSize;
@@ -29,6 +108,58 @@ struct FramebufferWidget::Internal {
 };
 
 
+/** Deletes pooled framebuffers, least recently released first, until the pool fits in the budget left by framebuffers in use. */
+static void trimPool(int64_t budget) {
+	while (FramebufferWidget_totalPixels + FramebufferWidget_poolPixels > budget && !FramebufferWidget_pool.empty()) {
+		popPool();
+	}
+}
+
+
+/** Deletes framebuffers until the total pixels are within the budget.
+Deletes pooled framebuffers first, then evicts framebuffers of widgets not drawn this frame or the previous one, least recently drawn first.
+Evicted framebuffers are returned to the pool, where they are kept if the budget allows.
+If visible framebuffers alone exceed the budget, the budget is exceeded instead of evicting them.
+*/
+static void enforceBudget() {
+	if (!(settings::framebufferBudget > 0.f))
+		return;
+	int64_t budget = settings::framebufferBudget * 1e6;
+
+	trimPool(budget);
+
+	int64_t frame = getFrame();
+	while (FramebufferWidget_totalPixels > budget && !FramebufferWidget_lru.empty()) {
+		FramebufferWidget* fbw = FramebufferWidget_lru.front();
+		// Don't evict framebuffers that are visible.
+		// Widgets not yet drawn this frame were drawn in the previous one, and evicting them would re-render them and evict the next, every frame.
+		if (fbw->internal->drawFrame >= frame - 1) {
+			static bool warned = false;
+			if (!warned) {
+				WARN("Visible framebuffers exceed the framebuffer budget of %g megapixels, so it is exceeded", settings::framebufferBudget);
+				warned = true;
+			}
+			break;
+		}
+		fbw->deleteFramebuffer();
+		fbw->setDirty();
+		FramebufferWidget_stats.evictions++;
+	}
+
+	trimPool(budget);
+}
+
+
+FramebufferWidget::Stats FramebufferWidget::getStats() {
+	Stats stats = FramebufferWidget_stats;
+	stats.count = FramebufferWidget_lru.size();
+	stats.pixels = FramebufferWidget_totalPixels;
+	stats.poolCount = FramebufferWidget_pool.size();
+	stats.poolPixels = FramebufferWidget_poolPixels;
+	return stats;
+}
+
+
 FramebufferWidget::FramebufferWidget() {
 	internal = new Internal;
 }
@@ -69,8 +200,10 @@ void FramebufferWidget::deleteFramebuffer() {
 	// If the framebuffer exists, the Window should exist.
 	assert(APP->window);
 
-	nvgluDeleteFramebuffer(internal->fb);
+	// Keep the framebuffer for reuse by another widget of the same size
+	releaseFramebuffer(internal->fb, internal->fbSize.x, internal->fbSize.y);
 	internal->fb = NULL;
+	FramebufferWidget_lru.erase(internal->lruIt);
 
 	FramebufferWidget_totalPixels -= internal->fbSize.area();
 }
@@ -134,6 +267,10 @@ void FramebufferWidget::draw(const DrawArgs& args) {
 	if (!internal->fb)
 		return;
 
+	// Mark as most recently drawn
+	internal->drawFrame = getFrame();
+	FramebufferWidget_lru.splice(FramebufferWidget_lru.end(), FramebufferWidget_lru, internal->lruIt);
+
 	// Draw framebuffer image, using world coordinates
 	nvgSave(args.vg);
 	nvgResetTransform(args.vg);
@@ -208,8 +345,14 @@ void FramebufferWidget::render(math::Vec scale, math::Vec offsetF, math::Rect cl
 		// Create a framebuffer
 		if (newFbSize.isFinite() && !newFbSize.isZero()) {
 			// DEBUG("Creating framebuffer of size (%f, %f)", VEC_ARGS(newFbSize));
-			internal->fb = nvgluCreateFramebuffer(vg, newFbSize.x, newFbSize.y, 0);
-			FramebufferWidget_totalPixels += newFbSize.area();
+			internal->fb = acquireFramebuffer(vg, newFbSize.x, newFbSize.y);
+			if (internal->fb) {
+				internal->lruIt = FramebufferWidget_lru.insert(FramebufferWidget_lru.end(), this);
+				// Protect from eviction while rendering
+				internal->drawFrame = getFrame();
+				FramebufferWidget_totalPixels += newFbSize.area();
+				enforceBudget();
+			}
 		}
 
 		// DEBUG("Framebuffer total pixels: %.1f Mpx", FramebufferWidget_totalPixels / 1e6);
@@ -234,7 +377,7 @@ void FramebufferWidget::render(math::Vec scale, math::Vec offsetF, math::Rect cl
 		// If oversampling, create another framebuffer and copy it to actual size.
 		math::Vec oversampledFbSize = internal->fbSize.mult(oversample).ceil();
 		// DEBUG("Creating %0.fx oversampled framebuffer of size (%f, %f)", oversample, VEC_ARGS(internal->fbSize));
-		NVGLUframebuffer* oversampledFb = nvgluCreateFramebuffer(fbVg, oversampledFbSize.x, oversampledFbSize.y, 0);
+		NVGLUframebuffer* oversampledFb = acquireFramebuffer(fbVg, oversampledFbSize.x, oversampledFbSize.y);
 
 		if (!oversampledFb) {
 			WARN("Oversampled framebuffer of size (%f, %f) could not be created for FramebufferWidget %p.", VEC_ARGS(oversampledFbSize), this);
@@ -268,7 +411,7 @@ void FramebufferWidget::render(math::Vec scale, math::Vec offsetF, math::Rect cl
 		nvgReset(fbVg);
 
 		nvgluBindFramebuffer(NULL);
-		nvgluDeleteFramebuffer(oversampledFb);
+		releaseFramebuffer(oversampledFb, oversampledFbSize.x, oversampledFbSize.y);
 	}
 };
 
@@ -318,6 +461,8 @@ void FramebufferWidget::onContextCreate(const ContextCreateEvent& e) {
 
 void FramebufferWidget::onContextDestroy(const ContextDestroyEvent& e) {
 	deleteFramebuffer();
+	// Pooled framebuffers belong to the context being destroyed
+	clearPool();
 	setDirty();
 	Widget::onContextDestroy(e);
 }
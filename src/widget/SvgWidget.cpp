@@ -31,7 +31,7 @@ void SvgWidget::draw(const DrawArgs& args) {
 	if (!svg)
 		return;
 
-	window::svgDraw(args.vg, svg->handle);
+	svg->draw(args.vg);
 }
 
 
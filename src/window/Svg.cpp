@@ -1,7 +1,13 @@
-#include <window/Svg.hpp>
 #include <map>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+
+#include <window/Svg.hpp>
 #include <math.hpp>
 #include <string.hpp>
+#include <system.hpp>
 
 
 // #define DEBUG_ONLY(x) x
@@ -12,9 +18,80 @@ namespace rack {
 namespace window {
 
 
+/** Path geometry flattened to line segments for a particular scale level */
+struct SvgLevel {
+	/** Concatenated (x, y) points of all paths in shape and path order */
+	std::vector<float> points;
+	/** Number of points of each path */
+	std::vector<int> pathSizes;
+};
+
+
+struct SvgGeometry {
+	/** Whether each path, in shape and path order, is a hole.
+	Computed once when the SVG is loaded.
+	*/
+	std::vector<bool> pathHoles;
+	/** Flattened geometry, keyed by the base-2 logarithm of the drawing scale */
+	std::map<int, SvgLevel> levels;
+};
+
+
+/** Cached geometry of each Svg.
+Kept outside of Svg so its layout stays compatible with plugins compiled against earlier headers.
+Entries are added when an Svg is loaded and removed when it is destroyed or reloaded.
+Since std::map doesn't move its elements, references to entries stay valid while other Svgs are loaded from preload() threads.
+*/
+static std::map<const Svg*, SvgGeometry> svgGeometries;
+static std::mutex svgGeometriesMutex;
+
+
+static bool isPathHole(NSVGshape* shape, NSVGpath* path);
+static void drawImage(NVGcontext* vg, NSVGimage* svg, const SvgGeometry* geometry, const SvgLevel* level);
+
+
 Svg::~Svg() {
 	if (handle)
 		nsvgDelete(handle);
+	std::lock_guard<std::mutex> lock(svgGeometriesMutex);
+	svgGeometries.erase(this);
+}
+
+
+/** Classifies every path of an image. */
+static void initGeometry(SvgGeometry& geometry, NSVGimage* handle) {
+	for (NSVGshape* shape = handle->shapes; shape; shape = shape->next) {
+		for (NSVGpath* path = shape->paths; path; path = path->next) {
+			geometry.pathHoles.push_back(isPathHole(shape, path));
+		}
+	}
+}
+
+
+/** Replaces the cached geometry of `svg` with that of its current handle. */
+static void resetGeometry(const Svg* svg) {
+	SvgGeometry geometry;
+	if (svg->handle)
+		initGeometry(geometry, svg->handle);
+	std::lock_guard<std::mutex> lock(svgGeometriesMutex);
+	if (svg->handle)
+		svgGeometries[svg] = std::move(geometry);
+	else
+		svgGeometries.erase(svg);
+}
+
+
+/** Returns the cached geometry of `svg`, classifying its paths if it was loaded without loadFile() or loadString(). */
+static SvgGeometry& getGeometry(const Svg* svg) {
+	{
+		std::lock_guard<std::mutex> lock(svgGeometriesMutex);
+		auto it = svgGeometries.find(svg);
+		if (it != svgGeometries.end())
+			return it->second;
+	}
+	resetGeometry(svg);
+	std::lock_guard<std::mutex> lock(svgGeometriesMutex);
+	return svgGeometries[svg];
 }
 
 
@@ -23,6 +100,7 @@ void Svg::loadFile(const std::string& filename) {
 		nsvgDelete(handle);
 
 	handle = nsvgParseFromFile(filename.c_str(), "px", SVG_DPI);
+	resetGeometry(this);
 	if (!handle)
 		throw Exception("Failed to load SVG %s", filename.c_str());
 	INFO("Loaded SVG %s", filename.c_str());
@@ -36,6 +114,7 @@ void Svg::loadString(const std::string& str) {
 	// nsvgParse modifies the input string
 	std::string strCopy = str;
 	handle = nsvgParse(&strCopy[0], "px", SVG_DPI);
+	resetGeometry(this);
 	std::string strEllip = string::ellipsize(str, 40);
 	if (!handle)
 		throw Exception("Failed to load SVG \"%s\"", strEllip.c_str());
@@ -87,20 +166,101 @@ int Svg::getNumPoints() {
 }
 
 
+/** Recursively subdivides a cubic Bezier curve until it is flat within `tol`, appending the end points of each line segment.
+Uses the same flatness criterion as NanoVG.
+*/
+static void flattenBezier(std::vector<float>& points, float x1, float y1, float x2, float y2, float x3, float y3, float x4, float y4, float tol, int depth) {
+	if (depth > 10)
+		return;
+
+	float dx = x4 - x1;
+	float dy = y4 - y1;
+	float d2 = std::fabs((x2 - x4) * dy - (y2 - y4) * dx);
+	float d3 = std::fabs((x3 - x4) * dy - (y3 - y4) * dx);
+	if ((d2 + d3) * (d2 + d3) < tol * (dx * dx + dy * dy)) {
+		points.push_back(x4);
+		points.push_back(y4);
+		return;
+	}
+
+	float x12 = (x1 + x2) * 0.5f;
+	float y12 = (y1 + y2) * 0.5f;
+	float x23 = (x2 + x3) * 0.5f;
+	float y23 = (y2 + y3) * 0.5f;
+	float x34 = (x3 + x4) * 0.5f;
+	float y34 = (y3 + y4) * 0.5f;
+	float x123 = (x12 + x23) * 0.5f;
+	float y123 = (y12 + y23) * 0.5f;
+	float x234 = (x23 + x34) * 0.5f;
+	float y234 = (y23 + y34) * 0.5f;
+	float x1234 = (x123 + x234) * 0.5f;
+	float y1234 = (y123 + y234) * 0.5f;
+
+	flattenBezier(points, x1, y1, x12, y12, x123, y123, x1234, y1234, tol, depth + 1);
+	flattenBezier(points, x1234, y1234, x234, y234, x34, y34, x4, y4, tol, depth + 1);
+}
+
+
+static void flattenImage(SvgLevel& level, NSVGimage* svg, float tol) {
+	for (NSVGshape* shape = svg->shapes; shape; shape = shape->next) {
+		for (NSVGpath* path = shape->paths; path; path = path->next) {
+			size_t start = level.points.size();
+			level.points.push_back(path->pts[0]);
+			level.points.push_back(path->pts[1]);
+			for (int i = 1; i < path->npts - 2; i += 3) {
+				float* p = &path->pts[2 * i];
+				flattenBezier(level.points, p[-2], p[-1], p[0], p[1], p[2], p[3], p[4], p[5], tol, 0);
+			}
+			level.pathSizes.push_back((level.points.size() - start) / 2);
+		}
+	}
+}
+
+
 void Svg::draw(NVGcontext* vg) {
 	if (!handle)
 		return;
-	svgDraw(vg, handle);
+
+	// Choose a level by the current scale, rounded up to the nearest power of 2.
+	float xform[6];
+	nvgCurrentTransform(vg, xform);
+	float scale = std::sqrt(std::fabs(xform[0] * xform[3] - xform[1] * xform[2]));
+	int levelIndex = 0;
+	if (scale > 0.f && std::isfinite(scale))
+		levelIndex = math::clamp((int) std::ceil(std::log2(scale)), -4, 6);
+
+	// Levels are only flattened and read here, on the UI thread.
+	SvgGeometry& geometry = getGeometry(this);
+	auto it = geometry.levels.find(levelIndex);
+	if (it == geometry.levels.end()) {
+		// NanoVG's tessellation tolerance is 0.25 px^2 at a pixel ratio of 1. Halve it to allow for high-DPI framebuffers, and convert it to local units.
+		float tol = 0.125f / std::ldexp(1.f, 2 * levelIndex);
+		SvgLevel& level = geometry.levels[levelIndex];
+		flattenImage(level, handle, tol);
+		it = geometry.levels.find(levelIndex);
+	}
+
+	drawImage(vg, handle, &geometry, &it->second);
 }
 
 
 static std::map<std::string, std::shared_ptr<Svg>> svgCache;
+/** Guards svgCache, since preload() fills it from worker threads. */
+static std::mutex svgCacheMutex;
+/** Set by record() */
+static thread_local std::set<std::string>* recordFilenames = NULL;
 
 
 std::shared_ptr<Svg> Svg::load(const std::string& filename) {
-	const auto& pair = svgCache.find(filename);
-	if (pair != svgCache.end())
-		return pair->second;
+	if (recordFilenames)
+		recordFilenames->insert(filename);
+
+	{
+		std::lock_guard<std::mutex> lock(svgCacheMutex);
+		const auto& pair = svgCache.find(filename);
+		if (pair != svgCache.end())
+			return pair->second;
+	}
 
 	// Load svg
 	std::shared_ptr<Svg> svg;
@@ -112,8 +272,38 @@ std::shared_ptr<Svg> Svg::load(const std::string& filename) {
 		WARN("%s", e.what());
 		svg = NULL;
 	}
-	svgCache[filename] = svg;
-	return svg;
+
+	std::lock_guard<std::mutex> lock(svgCacheMutex);
+	// If another thread loaded the same file in the meantime, use its Svg.
+	const auto& result = svgCache.insert(std::make_pair(filename, svg));
+	return result.first->second;
+}
+
+
+void Svg::preload(const std::vector<std::string>& filenames) {
+	std::atomic<size_t> nextIndex(0);
+	auto worker = [&]() {
+		size_t i;
+		while ((i = nextIndex++) < filenames.size()) {
+			load(filenames[i]);
+		}
+	};
+
+	// Use the current thread as one of the workers
+	int threadCount = std::min((int) filenames.size(), system::getLogicalCoreCount());
+	std::vector<std::thread> threads;
+	for (int i = 1; i < threadCount; i++) {
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+}
+
+
+void Svg::record(std::set<std::string>* filenames) {
+	recordFilenames = filenames;
 }
 
 
@@ -162,16 +352,79 @@ static float getLineCrossing(math::Vec p0, math::Vec p1, math::Vec p2, math::Vec
 	return -(d.x * b.y - d.y * b.x) / m;
 }
 
-void svgDraw(NVGcontext* vg, NSVGimage* svg) {
+/** Computes whether a path is a hole or a solid.
+Assume that no paths are crossing (usually true for normal SVG graphics).
+Also assume that the topology is the same if we use straight lines rather than Beziers (not always the case but usually true).
+Using the even-odd fill rule, if we draw a line from a point on the path to a point outside the boundary (e.g. top left) and count the number of times it crosses another path, the parity of this count determines whether the path is a hole (odd) or solid (even).
+*/
+static bool isPathHole(NSVGshape* shape, NSVGpath* path) {
+	int crossings = 0;
+	math::Vec p0 = math::Vec(path->pts[0], path->pts[1]);
+	math::Vec p1 = math::Vec(path->bounds[0] - 1.0, path->bounds[1] - 1.0);
+	// Iterate all other paths
+	for (NSVGpath* path2 = shape->paths; path2; path2 = path2->next) {
+		if (path2 == path)
+			continue;
+
+		// Iterate all lines on the path
+		if (path2->npts < 4)
+			continue;
+		for (int i = 1; i < path2->npts + 3; i += 3) {
+			float* p = &path2->pts[2 * i];
+			// The previous point
+			math::Vec p2 = math::Vec(p[-2], p[-1]);
+			// The current point
+			math::Vec p3 = (i < path2->npts) ? math::Vec(p[4], p[5]) : math::Vec(path2->pts[0], path2->pts[1]);
+			float crossing = getLineCrossing(p0, p1, p2, p3);
+			float crossing2 = getLineCrossing(p2, p3, p0, p1);
+			if (0.0 <= crossing && crossing < 1.0 && 0.0 <= crossing2) {
+				crossings++;
+			}
+		}
+	}
+	return crossings % 2 != 0;
+
+	/*
+	// Shoelace algorithm for computing the area, and thus the winding direction
+	float area = 0.0;
+	math::Vec p0 = math::Vec(path->pts[0], path->pts[1]);
+	for (int i = 1; i < path->npts; i += 3) {
+		float *p = &path->pts[2*i];
+		math::Vec p1 = (i < path->npts) ? math::Vec(p[4], p[5]) : math::Vec(path->pts[0], path->pts[1]);
+		area += 0.5 * (p1.x - p0.x) * (p1.y + p0.y);
+		printf("%f %f, %f %f\n", p0.x, p0.y, p1.x, p1.y);
+		p0 = p1;
+	}
+	printf("%f\n", area);
+
+	if (area < 0.0)
+		nvgPathWinding(vg, NVG_CCW);
+	else
+		nvgPathWinding(vg, NVG_CW);
+	*/
+}
+
+/** Draws an image.
+If `geometry` and `level` are given, replays their cached hole classification and flattened geometry instead of computing them.
+*/
+static void drawImage(NVGcontext* vg, NSVGimage* svg, const SvgGeometry* geometry, const SvgLevel* level) {
 	DEBUG_ONLY(printf("new image: %g x %g px\n", svg->width, svg->height);)
 	int shapeIndex = 0;
+	size_t pathIndex = 0;
+	const float* levelPoints = level ? level->points.data() : NULL;
 	// Iterate shape linked list
 	for (NSVGshape* shape = svg->shapes; shape; shape = shape->next, shapeIndex++) {
 		DEBUG_ONLY(printf("	new shape: %d id \"%s\", fillrule %d, from (%f, %f) to (%f, %f)\n", shapeIndex, shape->id, shape->fillRule, shape->bounds[0], shape->bounds[1], shape->bounds[2], shape->bounds[3]);)
 
 		// Visibility
-		if (!(shape->flags & NSVG_FLAGS_VISIBLE))
+		if (!(shape->flags & NSVG_FLAGS_VISIBLE)) {
+			// Skip this shape's cached paths
+			for (NSVGpath* path = shape->paths; path; path = path->next, pathIndex++) {
+				if (level)
+					levelPoints += 2 * level->pathSizes[pathIndex];
+			}
 			continue;
+		}
 
 		nvgSave(vg);
 
@@ -183,73 +436,36 @@ void svgDraw(NVGcontext* vg, NSVGimage* svg) {
 		nvgBeginPath(vg);
 
 		// Iterate path linked list
-		for (NSVGpath* path = shape->paths; path; path = path->next) {
+		for (NSVGpath* path = shape->paths; path; path = path->next, pathIndex++) {
 			DEBUG_ONLY(printf("		new path: %d points, %s, from (%f, %f) to (%f, %f)\n", path->npts, path->closed ? "closed" : "open", path->bounds[0], path->bounds[1], path->bounds[2], path->bounds[3]);)
 
-			nvgMoveTo(vg, path->pts[0], path->pts[1]);
-			for (int i = 1; i < path->npts; i += 3) {
-				float* p = &path->pts[2 * i];
-				nvgBezierTo(vg, p[0], p[1], p[2], p[3], p[4], p[5]);
-				// nvgLineTo(vg, p[4], p[5]);
-				DEBUG_ONLY(printf("			bezier (%f, %f) to (%f, %f)\n", p[-2], p[-1], p[4], p[5]);)
+			if (level) {
+				int size = level->pathSizes[pathIndex];
+				nvgMoveTo(vg, levelPoints[0], levelPoints[1]);
+				for (int i = 1; i < size; i++) {
+					nvgLineTo(vg, levelPoints[2 * i], levelPoints[2 * i + 1]);
+				}
+				levelPoints += 2 * size;
+			}
+			else {
+				nvgMoveTo(vg, path->pts[0], path->pts[1]);
+				for (int i = 1; i < path->npts; i += 3) {
+					float* p = &path->pts[2 * i];
+					nvgBezierTo(vg, p[0], p[1], p[2], p[3], p[4], p[5]);
+					// nvgLineTo(vg, p[4], p[5]);
+					DEBUG_ONLY(printf("			bezier (%f, %f) to (%f, %f)\n", p[-2], p[-1], p[4], p[5]);)
+				}
 			}
 
 			// Close path
 			if (path->closed)
 				nvgClosePath(vg);
 
-			// Compute whether this is a hole or a solid.
-			// Assume that no paths are crossing (usually true for normal SVG graphics).
-			// Also assume that the topology is the same if we use straight lines rather than Beziers (not always the case but usually true).
-			// Using the even-odd fill rule, if we draw a line from a point on the path to a point outside the boundary (e.g. top left) and count the number of times it crosses another path, the parity of this count determines whether the path is a hole (odd) or solid (even).
-			int crossings = 0;
-			math::Vec p0 = math::Vec(path->pts[0], path->pts[1]);
-			math::Vec p1 = math::Vec(path->bounds[0] - 1.0, path->bounds[1] - 1.0);
-			// Iterate all other paths
-			for (NSVGpath* path2 = shape->paths; path2; path2 = path2->next) {
-				if (path2 == path)
-					continue;
-
-				// Iterate all lines on the path
-				if (path2->npts < 4)
-					continue;
-				for (int i = 1; i < path2->npts + 3; i += 3) {
-					float* p = &path2->pts[2 * i];
-					// The previous point
-					math::Vec p2 = math::Vec(p[-2], p[-1]);
-					// The current point
-					math::Vec p3 = (i < path2->npts) ? math::Vec(p[4], p[5]) : math::Vec(path2->pts[0], path2->pts[1]);
-					float crossing = getLineCrossing(p0, p1, p2, p3);
-					float crossing2 = getLineCrossing(p2, p3, p0, p1);
-					if (0.0 <= crossing && crossing < 1.0 && 0.0 <= crossing2) {
-						crossings++;
-					}
-				}
-			}
-
-			if (crossings % 2 == 0)
-				nvgPathWinding(vg, NVG_SOLID);
-			else
+			bool hole = geometry ? geometry->pathHoles[pathIndex] : isPathHole(shape, path);
+			if (hole)
 				nvgPathWinding(vg, NVG_HOLE);
-
-			/*
-			// Shoelace algorithm for computing the area, and thus the winding direction
-			float area = 0.0;
-			math::Vec p0 = math::Vec(path->pts[0], path->pts[1]);
-			for (int i = 1; i < path->npts; i += 3) {
-				float *p = &path->pts[2*i];
-				math::Vec p1 = (i < path->npts) ? math::Vec(p[4], p[5]) : math::Vec(path->pts[0], path->pts[1]);
-				area += 0.5 * (p1.x - p0.x) * (p1.y + p0.y);
-				printf("%f %f, %f %f\n", p0.x, p0.y, p1.x, p1.y);
-				p0 = p1;
-			}
-			printf("%f\n", area);
-
-			if (area < 0.0)
-				nvgPathWinding(vg, NVG_CCW);
 			else
-				nvgPathWinding(vg, NVG_CW);
-			*/
+				nvgPathWinding(vg, NVG_SOLID);
 		}
 
 		// Fill shape
@@ -301,6 +517,10 @@ void svgDraw(NVGcontext* vg, NSVGimage* svg) {
 	DEBUG_ONLY(printf("\n");)
 }
 
+void svgDraw(NVGcontext* vg, NSVGimage* svg) {
+	drawImage(vg, svg, NULL, NULL);
+}
+
 
 } // namespace window
 } // namespace rack
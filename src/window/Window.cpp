@@ -14,11 +14,15 @@
 #include <asset.hpp>
 #include <widget/Widget.hpp>
 #include <app/Scene.hpp>
+#include <app/RackWidget.hpp>
+#include <app/ModuleWidget.hpp>
+#include <engine/Module.hpp>
 #include <keyboard.hpp>
 #include <gamepad.hpp>
 #include <context.hpp>
 #include <patch.hpp>
 #include <settings.hpp>
+#include <trace.hpp>
 #include <plugin.hpp> // used in Window::screenshot
 #include <system.hpp> // used in Window::screenshot
 
@@ -92,6 +96,15 @@ struct Window::Internal {
 	double monitorRefreshRate = 0.0;
 	double frameTime = NAN;
 	double lastFrameDuration = NAN;
+	/** Frame rate limit in effect for the current frame, depending on whether the window is focused, visible, and idle */
+	float frameRateLimit = 0.f;
+	/** Time of the last input event or engine-driven change */
+	double lastActivityTime = -INFINITY;
+	/** Whether the current frame is throttled by `settings::idleFrameRateLimit` */
+	bool idle = false;
+	bool lastFocused = false;
+	/** Light brightnesses and param values of all modules when they last changed visibly */
+	std::vector<float> engineSnapshot;
 
 	math::Vec lastMousePos;
 
@@ -103,6 +116,12 @@ struct Window::Internal {
 };
 
 
+/** Ends idle throttling, including the wait for the current frame. */
+static void setActive() {
+	APP->window->internal->lastActivityTime = system::getTime();
+}
+
+
 static void windowPosCallback(GLFWwindow* win, int x, int y) {
 	if (glfwGetWindowAttrib(win, GLFW_MAXIMIZED))
 		return;
@@ -148,6 +167,7 @@ static void mouseButtonCallback(GLFWwindow* win, int button, int action, int mod
 	}
 #endif
 
+	setActive();
 	APP->event->handleButton(APP->window->internal->lastMousePos, button, action, mods);
 }
 
@@ -179,6 +199,9 @@ static void cursorPosCallback(GLFWwindow* win, double xpos, double ypos) {
 	glfwSetCursor(win, NULL);
 #endif
 
+	// This is called every frame, so only moving the mouse counts as activity.
+	if (!mousePos.equals(APP->window->internal->lastMousePos))
+		setActive();
 	APP->window->internal->lastMousePos = mousePos;
 
 	APP->event->handleHover(mousePos, mouseDelta);
@@ -193,6 +216,7 @@ static void cursorPosCallback(GLFWwindow* win, double xpos, double ypos) {
 
 static void cursorEnterCallback(GLFWwindow* win, int entered) {
 	contextSet((Context*) glfwGetWindowUserPointer(win));
+	setActive();
 	if (!entered) {
 		APP->event->handleLeave();
 	}
@@ -208,12 +232,14 @@ static void scrollCallback(GLFWwindow* win, double x, double y) {
 	scrollDelta = scrollDelta.mult(50.0);
 #endif
 
+	setActive();
 	APP->event->handleScroll(APP->window->internal->lastMousePos, scrollDelta);
 }
 
 
 static void charCallback(GLFWwindow* win, unsigned int codepoint) {
 	contextSet((Context*) glfwGetWindowUserPointer(win));
+	setActive();
 	if (APP->event->handleText(APP->window->internal->lastMousePos, codepoint))
 		return;
 }
@@ -221,6 +247,7 @@ static void charCallback(GLFWwindow* win, unsigned int codepoint) {
 
 static void keyCallback(GLFWwindow* win, int key, int scancode, int action, int mods) {
 	contextSet((Context*) glfwGetWindowUserPointer(win));
+	setActive();
 	if (APP->event->handleKey(APP->window->internal->lastMousePos, key, scancode, action, mods))
 		return;
 
@@ -240,6 +267,7 @@ static void dropCallback(GLFWwindow* win, int count, const char** paths) {
 	for (int i = 0; i < count; i++) {
 		pathsVec.push_back(paths[i]);
 	}
+	setActive();
 	APP->event->handleDrop(APP->window->internal->lastMousePos, pathsVec);
 }
 
@@ -251,6 +279,7 @@ static void errorCallback(int error, const char* description) {
 
 Window::Window() {
 	internal = new Internal;
+	internal->lastActivityTime = system::getTime();
 	int err;
 
 	// Set window hints
@@ -412,7 +441,42 @@ void Window::run() {
 }
 
 
+/** Returns whether any light or param of the modules in the rack changed visibly since the last change. */
+static bool updateEngineSnapshot(std::vector<float>& snapshot) {
+	bool changed = false;
+	size_t i = 0;
+	auto check = [&](float value, float threshold) {
+		if (i >= snapshot.size()) {
+			snapshot.push_back(value);
+			changed = true;
+		}
+		else if (!(std::fabs(value - snapshot[i]) <= threshold)) {
+			snapshot[i] = value;
+			changed = true;
+		}
+		i++;
+	};
+	for (app::ModuleWidget* mw : APP->scene->rack->getModules()) {
+		engine::Module* module = mw->getModule();
+		if (!module)
+			continue;
+		// Smaller brightness changes aren't visible in 8-bit color.
+		for (engine::Light& light : module->lights)
+			check(light.getBrightness(), 1 / 256.f);
+		// Params can change without input, e.g. by MIDI mapping or smoothing.
+		for (engine::Param& param : module->params)
+			check(param.getValue(), 0.f);
+	}
+	if (i != snapshot.size()) {
+		snapshot.resize(i);
+		changed = true;
+	}
+	return changed;
+}
+
+
 void Window::step() {
+	TRACE_SCOPE("Window::step");
 	double frameTime = system::getTime();
 	if (std::isfinite(internal->frameTime)) {
 		internal->lastFrameDuration = frameTime - internal->frameTime;
@@ -429,7 +493,10 @@ void Window::step() {
 	// Poll events
 	// Save and restore context because event handler set their own context based on which window they originate from.
 	Context* context = contextGet();
-	glfwPollEvents();
+	{
+		TRACE_SCOPE("Window events");
+		glfwPollEvents();
+	}
 	contextSet(context);
 
 	// In case glfwPollEvents() sets another OpenGL context
@@ -476,6 +543,30 @@ void Window::step() {
 	int winWidth, winHeight;
 	glfwGetWindowSize(win, &winWidth, &winHeight);
 	windowRatio = (float)fbWidth / winWidth;
+
+	// Throttle frames while nothing changes or the window is in the background
+	bool visible = glfwGetWindowAttrib(win, GLFW_VISIBLE) && !glfwGetWindowAttrib(win, GLFW_ICONIFIED);
+	bool focused = glfwGetWindowAttrib(win, GLFW_FOCUSED);
+	if (focused != internal->lastFocused) {
+		internal->lastFocused = focused;
+		setActive();
+	}
+	// The CPU meter changes every frame.
+	if (APP->scene && (updateEngineSnapshot(internal->engineSnapshot) || settings::cpuMeter))
+		setActive();
+	internal->idle = (frameTime - internal->lastActivityTime >= settings::idleTimeout);
+	auto limitFrameRate = [&](float limit) {
+		if (limit > 0 && (internal->frameRateLimit <= 0 || limit < internal->frameRateLimit))
+			internal->frameRateLimit = limit;
+	};
+	internal->frameRateLimit = settings::frameRateLimit;
+	if (internal->idle)
+		limitFrameRate(settings::idleFrameRateLimit);
+	if (!visible || !focused)
+		limitFrameRate(settings::backgroundFrameRateLimit);
+	// Nothing is presented while hidden, so there is no vsync to block on. Avoid spinning.
+	if (!visible && internal->frameRateLimit <= 0)
+		internal->frameRateLimit = 60.f;
 	// t1 = system::getTime();
 
 	if (APP->scene) {
@@ -484,11 +575,13 @@ void Window::step() {
 		APP->scene->box.size = math::Vec(fbWidth, fbHeight).div(pixelRatio);
 
 		// Step scene
-		APP->scene->step();
+		{
+			TRACE_SCOPE("Scene::step");
+			APP->scene->step();
+		}
 		// t2 = system::getTime();
 
 		// Render scene
-		bool visible = glfwGetWindowAttrib(win, GLFW_VISIBLE) && !glfwGetWindowAttrib(win, GLFW_ICONIFIED);
 		if (visible) {
 			// Update and render
 			nvgBeginFrame(vg, fbWidth, fbHeight, pixelRatio);
@@ -498,24 +591,50 @@ void Window::step() {
 			widget::Widget::DrawArgs args;
 			args.vg = vg;
 			args.clipBox = APP->scene->box.zeroPos();
-			APP->scene->draw(args);
+			{
+				TRACE_SCOPE("Scene::draw");
+				APP->scene->draw(args);
+			}
 			// t3 = system::getTime();
 
 			glViewport(0, 0, fbWidth, fbHeight);
 			glClearColor(0.0, 0.0, 0.0, 1.0);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-			nvgEndFrame(vg);
+			{
+				TRACE_SCOPE("nvgEndFrame");
+				nvgEndFrame(vg);
+			}
 		}
 		// t4 = system::getTime();
 	}
 
-	glfwSwapBuffers(win);
-
-	// Limit frame rate
-	if (settings::frameRateLimit > 0) {
-		double remaining = getFrameDurationRemaining();
-		if (remaining > 0.0) {
-			system::sleep(remaining);
+	// Don't swap a back buffer that wasn't drawn
+	if (visible) {
+		TRACE_SCOPE("glfwSwapBuffers");
+		glfwSwapBuffers(win);
+	}
+
+	// Limit frame rate.
+	// Instead of sleeping, handle input events as they arrive so their latency isn't tied to the frame rate.
+	if (internal->frameRateLimit > 0) {
+		nvgReset(vg);
+		bndSetFont(uiFont->handle);
+		Context* context = contextGet();
+		while (true) {
+			double remaining = getFrameDurationRemaining();
+			if (remaining <= 0.0)
+				break;
+			// Some platforms wait with millisecond granularity, so sleep through the last fraction.
+			if (remaining < 0.002) {
+				system::sleep(remaining);
+				break;
+			}
+			glfwWaitEventsTimeout(remaining - 0.001);
+			contextSet(context);
+			glfwMakeContextCurrent(win);
+			// Draw the next frame right away if input ended idle throttling.
+			if (internal->idle && internal->lastActivityTime >= frameTime)
+				break;
 		}
 	}
 
@@ -709,7 +828,7 @@ double Window::getLastFrameDuration() {
 
 
 double Window::getFrameDurationRemaining() {
-	double frameDuration = 1.f / settings::frameRateLimit;
+	double frameDuration = 1.f / internal->frameRateLimit;
 	return frameDuration - (system::getTime() - internal->frameTime);
 }
 